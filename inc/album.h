@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.1 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://floralicense.org/license/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_ALBUM_H)
+#define _ALBUM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Starting sizes, both grow by doubling */
+#define ALBUM_STORE_MIN_ENTRIES 32
+#define ALBUM_STORE_MIN_ARENA 4096
+
+/* Cache file layout version, bump on any change */
+#define ALBUM_CACHE_VERSION 1
+
+/* Media DB state the cache was written against */
+typedef struct _album_stamp {
+	unsigned int media_count;
+	long long modified;
+} album_stamp_s;
+
+/*
+ * Borrowed view of one album. The strings point into the store arena and
+ * stay valid until the store is next modified.
+ */
+typedef struct _album_info {
+	int album_id;
+	const char *title;
+	const char *artist;
+	const char *album_art;
+	const char *file_path;
+} album_info_s;
+
+/*
+ * Release every album and string at once
+ */
+void album_store_clear(void);
+
+int album_store_add(int album_id, const char *title, const char *artist, const char *album_art, const char *file_path);
+bool album_store_remove(const char *file_path);
+int album_store_find(const char *file_path);
+int album_store_find_album(int album_id);
+int album_store_count(void);
+bool album_store_get(int index, album_info_s *info);
+size_t album_store_memory(void);
+
+/*
+ * The cache file is the store itself: a header, the entries in list order
+ * with arena offsets, then the arena. Loading maps the file and copies it
+ * in with no parsing of the strings.
+ */
+bool album_store_save(const char *path, const album_stamp_s *stamp);
+bool album_store_load(const char *path, album_stamp_s *stamp);
+
+#endif
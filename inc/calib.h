@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_CALIB_H)
+#define _CALIB_H
+
+#include <stdbool.h>
+#include "protocol.h"
+
+/* Wiimote accelerometer counts, matching the calibration block Dolphin assumes */
+#define CALIB_WIIMOTE_ZERO_G 512
+#define CALIB_WIIMOTE_ONE_G 616
+#define CALIB_WIIMOTE_MAX 1023
+
+/* Readings averaged for one reference, the watch must stay still meanwhile */
+#define CALIB_CAPTURE_SAMPLES 32
+/* Samples after which an unsteady capture is abandoned */
+#define CALIB_CAPTURE_MAX 512
+/* Largest spread in m/s^2 on any axis that still counts as still */
+#define CALIB_STEADY_RANGE 0.6f
+
+typedef enum {
+	CALIB_STEP_FACE_UP = 1,		/* lying flat, screen up: zero-g on x and y, one-g on z */
+	CALIB_STEP_FACE_DOWN = 2,	/* lying flat, screen down: zero-g on z */
+	CALIB_STEP_RESET = 3,		/* back to the nominal sensor scale */
+} calib_step_e;
+
+typedef enum {
+	CALIB_STATUS_DONE = 0,
+	CALIB_STATUS_UNSTEADY = 1,	/* the watch moved during the capture */
+	CALIB_STATUS_OUT_OF_RANGE = 2,	/* the reference does not look like one g */
+} calib_status_e;
+
+/*
+ * Initialize the calibration component from the stored references
+ */
+void calib_initialize(void);
+
+void calib_handle_message(const proto_view_s *body);
+bool calib_feed(const float *accel);
+int calib_build_message(unsigned char *buf, int buf_size);
+
+/*
+ * Convert one accelerometer reading in m/s^2 to packed Wiimote counts,
+ * x in bits 0..9, y in bits 10..19, z in bits 20..29
+ */
+unsigned int calib_to_wiimote(const float *accel);
+
+#endif
@@ -17,12 +17,22 @@
 #if !defined(_DATA_H)
 #define _DATA_H
 
+#include <stddef.h>
+
 typedef enum {
 	DEVICE_INFO_GEAR = 0,
 	DEVICE_INFO_PHONE = 1,
 	DEVICE_INFO_MAX,
 } device_info_e;
 
+/* Files resolved once against the resource directory, see data_get_resource() */
+typedef enum {
+	DATA_RESOURCE_EDJ = 0,
+	DATA_RESOURCE_DEVICE_GEAR,
+	DATA_RESOURCE_DEVICE_PHONE,
+	DATA_RESOURCE_MAX,
+} data_resource_e;
+
 /*
  * Initialize the data component
  */
@@ -33,20 +43,27 @@ void data_initialize(void);
  */
 void data_finalize(void);
 
+/*
+ * Release the resolved resource paths, borrowed strings are invalid afterwards
+ */
+void data_destroy_resources(void);
+
 void data_get_resource_path(const char *file_in, char *file_path_out, int file_path_max);
-Eina_List *data_get_album_list(void);
-char *data_get_album_title(Eina_List *list, int index);
-char *data_get_album_artist(Eina_List *list, int index);
-char *data_get_album_art(Eina_List *list, int index);
-char *data_get_album_file_path(Eina_List *list, int index);
-char *data_get_device_image(device_info_e device);
-char *data_get_image(const char *part);
+const char *data_get_resource(data_resource_e resource);
+int data_get_album_count(void);
+const char *data_get_album_title(int index);
+const char *data_get_album_artist(int index);
+const char *data_get_album_art(int index);
+const char *data_get_album_file_path(int index);
+const char *data_get_device_image(device_info_e device);
 char *data_get_more_button_main_text(int index);
 char *data_get_more_button_sub_text(int index);
 char *data_get_more_button_image(int index);
 void data_destroy_album_list(void);
-Eina_List *data_create_album_list(void);
-Eina_List *data_update_album_list(void);
-Eina_List *data_remove_album_data_by_file_path(const char *file_path);
+int data_create_album_list(void);
+int data_update_album_list(void);
+int data_remove_album_data_by_file_path(const char *file_path);
+size_t data_trim_album_list(void);
+size_t data_album_memory(void);
 
 #endif
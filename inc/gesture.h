@@ -0,0 +1,55 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_GESTURE_H)
+#define _GESTURE_H
+
+#include <stdbool.h>
+#include "protocol.h"
+
+typedef enum {
+	GESTURE_NONE = 0,
+	GESTURE_SHAKE = 1,
+	GESTURE_SWING_LEFT = 2,
+	GESTURE_SWING_RIGHT = 3,
+	GESTURE_TILT_LEFT = 4,
+	GESTURE_TILT_RIGHT = 5,
+	GESTURE_TILT_FORWARD = 6,
+	GESTURE_TILT_BACK = 7,
+	GESTURE_MAX,
+} gesture_type_e;
+
+#define GESTURE_BIT(type) (1u << ((type) - 1))
+#define GESTURE_ALL (GESTURE_BIT(GESTURE_MAX) - 1)
+
+typedef struct _gesture_event {
+	gesture_type_e type;
+	unsigned int strength;		/* 0..255, how far past the threshold */
+	unsigned long long timestamp;	/* sensor timestamp in microseconds */
+} gesture_event_s;
+
+/*
+ * Initialize the gesture component, disabled until gesture_set_enabled()
+ */
+void gesture_initialize(void);
+
+void gesture_set_enabled(unsigned int gestures);
+unsigned int gesture_get_enabled(void);
+void gesture_handle_message(const proto_view_s *body);
+bool gesture_feed(unsigned long long timestamp, const float *accel, gesture_event_s *event_out);
+int gesture_build_message(const gesture_event_s *event, unsigned char *buf, int buf_size);
+
+#endif
@@ -27,12 +27,34 @@
 
 #define NUM_OF_ITEMS 5
 
-void keyReleased();
-void keyPressed();
+/* Seconds without a poll before controller only mode gives the full UI back */
+#define CONTROLLER_ONLY_IDLE 2.0
+
+/* Bit index of each controller button in the key mask */
+typedef enum {
+	CONTROLLER_KEY_LEFT = 0,
+	CONTROLLER_KEY_RIGHT,
+	CONTROLLER_KEY_UP,
+	CONTROLLER_KEY_DOWN,
+	CONTROLLER_KEY_A,
+	CONTROLLER_KEY_B,
+} controller_key_e;
+
+/* Startup milestones, logged once as time since app_create */
+typedef enum {
+	STARTUP_FIRST_SAMPLE = 0,
+	STARTUP_FIRST_FRAME,
+} startup_mark_e;
+
+void keyReleased(int index);
+void keyPressed(int index);
 void initialize_sap();
 void turn_on_screen();
+void configure_sensors(void);
 void data_finalize();
 void update_ui(char *data);
+void startup_mark(startup_mark_e mark);
+void render_streaming_active(void);
 
 #if !defined(PACKAGE)
 #define PACKAGE "org.tizen.hellomessageprovider"
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_LOGGER_H)
+#define _LOGGER_H
+
+#include <stddef.h>
+#include <dlog.h>
+
+/* Same values as log_priority so they can be compared in #if */
+#define LOGGER_LEVEL_DEBUG 3
+#define LOGGER_LEVEL_INFO 4
+#define LOGGER_LEVEL_WARN 5
+#define LOGGER_LEVEL_ERROR 6
+
+/* Lowest level compiled in, debug calls vanish from release builds */
+#if !defined(LOGGER_LEVEL)
+#if defined(NDEBUG)
+#define LOGGER_LEVEL LOGGER_LEVEL_INFO
+#else
+#define LOGGER_LEVEL LOGGER_LEVEL_DEBUG
+#endif
+#endif
+
+#define LOGGER_RING_SIZE 64
+#define LOGGER_ENTRY_SIZE 128
+/* Flush period in seconds and entries written per flush */
+#define LOGGER_FLUSH_INTERVAL 0.5
+#define LOGGER_FLUSH_BATCH 16
+
+/*
+ * Debug, info and warning messages are formatted into a preallocated ring
+ * and written to dlog from a timer. Errors skip the ring so they are never
+ * lost to a crash or a full ring. The tag must be a string literal.
+ */
+#if LOGGER_LEVEL <= LOGGER_LEVEL_DEBUG
+#define LOGGER_D(tag, ...) logger_write(DLOG_DEBUG, tag, __VA_ARGS__)
+#else
+#define LOGGER_D(tag, ...) do { } while (0)
+#endif
+
+#if LOGGER_LEVEL <= LOGGER_LEVEL_INFO
+#define LOGGER_I(tag, ...) logger_write(DLOG_INFO, tag, __VA_ARGS__)
+#else
+#define LOGGER_I(tag, ...) do { } while (0)
+#endif
+
+#if LOGGER_LEVEL <= LOGGER_LEVEL_WARN
+#define LOGGER_W(tag, ...) logger_write(DLOG_WARN, tag, __VA_ARGS__)
+#else
+#define LOGGER_W(tag, ...) do { } while (0)
+#endif
+
+#define LOGGER_E(tag, ...) dlog_print(DLOG_ERROR, tag, __VA_ARGS__)
+
+/*
+ * Initialize the logger, messages written before are passed straight to dlog
+ */
+void logger_initialize(void);
+
+/*
+ * Flush everything still queued and go back to writing straight to dlog
+ */
+void logger_finalize(void);
+
+size_t logger_memory(void);
+void logger_write(log_priority prio, const char *tag, const char *fmt, ...) __attribute__((format(printf, 3, 4)));
+
+#endif
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_OUTBOX_H)
+#define _OUTBOX_H
+
+#include <stdbool.h>
+
+/* Sends without a delivery status before the outbox holds messages back */
+#define OUTBOX_INFLIGHT_MAX 4
+/* A send without a delivery status after this long no longer counts as in flight */
+#define OUTBOX_INFLIGHT_TIMEOUT 0.1
+/* Queued key and control messages, and the largest one */
+#define OUTBOX_CONTROL_MAX 16
+#define OUTBOX_CONTROL_SIZE 64
+/* Retry period while messages are held back */
+#define OUTBOX_RETRY_INTERVAL 0.005
+/* Sends of one control message that may fail before it is dropped */
+#define OUTBOX_CONTROL_ATTEMPTS 20
+
+/*
+ * Sends a message, returns the transaction id, 0 if the send failed but
+ * may succeed later, or a value < 0 if it never will
+ */
+typedef int (*outbox_send_cb)(unsigned char *buf, int len);
+
+/*
+ * Builds the motion message when the lane gets its turn, returns its
+ * length or 0 for nothing to send
+ */
+typedef int (*outbox_build_cb)(unsigned char *buf, int buf_size);
+
+/*
+ * Initialize the outbox component
+ */
+void outbox_initialize(outbox_send_cb send, outbox_build_cb build_motion);
+
+/*
+ * Finalize the outbox component, dropping anything still queued
+ */
+void outbox_finalize(void);
+
+bool outbox_push_control(const unsigned char *buf, int len);
+void outbox_request_motion(void);
+void outbox_delivered(int transaction_id);
+
+#endif
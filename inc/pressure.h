@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_PRESSURE_H)
+#define _PRESSURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Period of the simulated limit check, only runs while a limit is set */
+#define PRESSURE_CHECK_INTERVAL 5.0
+
+typedef enum {
+	PRESSURE_ALBUMS,
+	PRESSURE_THUMBNAILS,
+	PRESSURE_SAMPLES,
+	PRESSURE_LOGS,
+	PRESSURE_SUBSYSTEM_MAX,
+} pressure_subsystem_e;
+
+/*
+ * Per subsystem accounting. Subsystems with a trim hook give memory back
+ * on a low memory event; the sample and log rings are fixed arrays and
+ * are only counted.
+ */
+size_t pressure_usage(pressure_subsystem_e subsystem);
+size_t pressure_total(void);
+
+/*
+ * Trim every subsystem, log what each gave back and return the total
+ */
+size_t pressure_release(void);
+
+/*
+ * Simulated memory limit in bytes, 0 for none. While set, the memory the
+ * trim hooks can give back is checked periodically and released once it
+ * goes over, the same way a low memory event would. A release that frees
+ * nothing stops the check until the limit is set again.
+ */
+void pressure_set_limit(size_t limit);
+bool pressure_check(void);
+
+/*
+ * Stop the limit check
+ */
+void pressure_finalize(void);
+
+#endif
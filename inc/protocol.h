@@ -0,0 +1,323 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_PROTOCOL_H)
+#define _PROTOCOL_H
+
+#include <stdbool.h>
+
+/*
+ * Wire format shared with the phone.
+ *
+ * Typed messages start with a 4 byte header:
+ *   [0] PROTO_MAGIC
+ *   [1] message type (proto_msg_type_e)
+ *   [2..3] body length, little endian
+ * Any payload that does not start with PROTO_MAGIC is a legacy poll and
+ * is answered with the legacy text sample.
+ */
+#define PROTO_MAGIC 0xD7
+#define PROTO_HEADER_SIZE 4
+#define PROTO_VERSION 1
+
+typedef enum {
+	PROTO_MSG_POLL = 0x01,		/* phone -> watch, empty body */
+	PROTO_MSG_CONFIG = 0x02,	/* phone -> watch, proto_config body */
+	PROTO_MSG_CONFIG_ACK = 0x03,	/* watch -> phone, proto_config body */
+	PROTO_MSG_HELLO = 0x04,		/* phone -> watch, hello body */
+	PROTO_MSG_HELLO_ACK = 0x05,	/* watch -> phone, hello ack body */
+	PROTO_MSG_RUMBLE = 0x06,	/* phone -> watch, rumble body */
+	PROTO_MSG_GESTURES = 0x07,	/* phone -> watch, gestures body */
+	PROTO_MSG_CALIBRATE = 0x08,	/* phone -> watch, calibrate body */
+	PROTO_MSG_REDUNDANCY = 0x09,	/* phone -> watch, redundancy body */
+	PROTO_MSG_DEADBAND = 0x0A,	/* phone -> watch, dead-band body */
+	PROTO_MSG_GESTURE = 0x11,	/* watch -> phone, gesture event */
+	PROTO_MSG_CALIBRATION = 0x12,	/* watch -> phone, calibration result */
+	PROTO_MSG_HEARTBEAT = 0x13,	/* watch -> phone, nothing moved */
+	PROTO_MSG_KEYS = 0x14,		/* watch -> phone, key change */
+	PROTO_MSG_SAMPLES = 0x10,	/* watch -> phone, binary samples */
+} proto_msg_type_e;
+
+/*
+ * Capability bits exchanged in the handshake
+ */
+typedef enum {
+	PROTO_CAP_BINARY = 1 << 0,	/* PROTO_MSG_SAMPLES instead of text */
+	PROTO_CAP_BATCHING = 1 << 1,	/* more than one sample per message */
+	PROTO_CAP_GYRO = 1 << 2,	/* gyro axes in samples */
+	PROTO_CAP_TIMESTAMPS = 1 << 3,	/* per sample timestamps */
+	PROTO_CAP_RUMBLE = 1 << 4,	/* PROTO_MSG_RUMBLE drives the motor */
+	PROTO_CAP_WHEEL = 1 << 5,	/* bezel wheel block in samples */
+	PROTO_CAP_POINTER = 1 << 6,	/* touch pointer block in samples */
+	PROTO_CAP_GESTURES = 1 << 7,	/* on watch gesture recognition */
+	PROTO_CAP_WIIMOTE = 1 << 8,	/* accel in calibrated Wiimote counts */
+	PROTO_CAP_REDUNDANCY = 1 << 9,	/* samples repeated from earlier messages */
+	PROTO_CAP_DEADBAND = 1 << 10,	/* heartbeats instead of samples while still */
+	PROTO_CAP_KEY_EVENTS = 1 << 11,	/* PROTO_MSG_KEYS as soon as a key changes */
+} proto_cap_e;
+
+/*
+ * Hello body, 4 bytes. A phone that never sends it is served the legacy
+ * text stream.
+ *   [0] highest protocol version the phone speaks
+ *   [1] reserved
+ *   [2..3] capability bitmask of the phone, little endian
+ */
+#define PROTO_HELLO_SIZE 4
+
+/*
+ * Hello ack body, 6 bytes followed by a config body with the mode picked:
+ *   [0] protocol version both sides speak
+ *   [1] reserved
+ *   [2..3] capability bitmask of the watch, little endian
+ *   [4..5] capabilities in use, little endian
+ */
+#define PROTO_HELLO_ACK_SIZE 6
+
+/*
+ * Fields present in a config body that carries a field mask
+ */
+typedef enum {
+	PROTO_CONFIG_FIELD_INTERVAL = 1 << 0,
+	PROTO_CONFIG_FIELD_BATCH = 1 << 1,
+	PROTO_CONFIG_FIELD_SENSORS = 1 << 2,
+	PROTO_CONFIG_FIELD_ENCODING = 1 << 3,
+	PROTO_CONFIG_FIELD_MODE = 1 << 4,
+	PROTO_CONFIG_FIELD_BATCH_LATENCY = 1 << 5,
+	PROTO_CONFIG_FIELD_ALL = (1 << 6) - 1,
+} proto_config_field_e;
+
+/*
+ * Config body, 8 bytes, 9 with the field mask:
+ *   [0..1] sensor interval in ms, little endian, 0 for the sensor default
+ *   [2] samples per reply, 0 for every pending sample up to the maximum
+ *   [3] sensor bitmask (stream_sensor_e)
+ *   [4] encoding (stream_encoding_e)
+ *   [5] input mode (stream_mode_e)
+ *   [6..7] sensor hardware batch latency in ms, little endian, 0 or 0xffff
+ *          for no batching
+ *   [8] proto_config_field_e bits of the fields to apply, the others keep
+ *       their current value
+ * Without the mask a zero field keeps the current value. Phones from before
+ * batching send the first 6 bytes only.
+ * Acks always carry the 8 byte body with every field.
+ */
+#define PROTO_CONFIG_SIZE 8
+#define PROTO_CONFIG_MIN_SIZE 6
+#define PROTO_CONFIG_FIELDS_SIZE 9
+
+/*
+ * Rumble body, 4 bytes:
+ *   [0] 1 to start, 0 to stop
+ *   [1] intensity 1..100, 0 for the default
+ *   [2..3] duration in ms, little endian, 0 to run until stopped
+ * "Until stopped" is capped on the watch so a lost stop message on the
+ * unreliable channel cannot leave the motor running.
+ */
+#define PROTO_RUMBLE_SIZE 4
+
+/*
+ * Gestures body, 2 bytes:
+ *   [0] bitmask of gestures to recognise (gesture_type_e), 0 turns it off
+ *   [1] keep one raw sample out of this many while recognising, 0 or 1 for all
+ */
+#define PROTO_GESTURES_SIZE 2
+
+/*
+ * Gesture event body, 6 bytes, sent as soon as a gesture is recognised:
+ *   [0] gesture_type_e
+ *   [1] strength 0..255
+ *   [2..5] sensor timestamp in ms, little endian
+ */
+#define PROTO_GESTURE_SIZE 6
+
+/*
+ * Calibrate body, 1 byte:
+ *   [0] calib_step_e, the watch must lie still in that pose
+ */
+#define PROTO_CALIBRATE_SIZE 1
+
+/*
+ * Calibration result body, 6 bytes, sent when a capture finishes:
+ *   [0] calib_step_e
+ *   [1] calib_status_e
+ *   [2..3] Wiimote zero-g count, little endian
+ *   [4..5] Wiimote one-g count, little endian
+ */
+#define PROTO_CALIBRATION_SIZE 6
+
+/*
+ * Redundancy body, 3 bytes:
+ *   [0] proto_redundancy_e
+ *   [1] samples to repeat with PROTO_REDUNDANCY_FIXED, upper limit with
+ *       PROTO_REDUNDANCY_ADAPTIVE
+ *   [2] share of messages lost by the phone in percent, adaptive mode only,
+ *       sent again whenever it changes
+ */
+typedef enum {
+	PROTO_REDUNDANCY_OFF = 0,
+	PROTO_REDUNDANCY_FIXED = 1,
+	PROTO_REDUNDANCY_ADAPTIVE = 2,
+} proto_redundancy_e;
+
+#define PROTO_REDUNDANCY_SIZE 3
+
+/*
+ * Dead-band body, 3 bytes:
+ *   [0..1] largest change in 1/100 m/s^2 (1/10 deg/s for the gyro), or in
+ *          Wiimote counts with PROTO_CAP_WIIMOTE, that still counts as
+ *          still, little endian, 0 turns suppression off
+ *   [2] send full samples again after this many heartbeats in a row,
+ *       0 for the default
+ */
+#define PROTO_DEADBAND_SIZE 3
+
+/*
+ * Heartbeat body, 2 bytes, sent in place of a samples message while the
+ * watch is still and no key changed. The phone keeps the last samples.
+ * The first sample past the dead-band is sent at once, without a poll.
+ *   [0] key bitmask
+ *   [1] samples suppressed, saturates at 255
+ */
+#define PROTO_HEARTBEAT_SIZE 2
+
+/*
+ * Keys body, 1 byte, sent on every press and release ahead of any motion.
+ * Samples messages still carry the key mask, which wins if one is lost.
+ *   [0] bitmask of the keys held down
+ */
+#define PROTO_KEYS_SIZE 1
+
+/*
+ * Samples body:
+ *   [0] sample count
+ *   [1] sensor bitmask of the samples
+ *   [2] key bitmask
+ *   [3] flags (proto_samples_flag_e)
+ * followed by a wheel block, only with PROTO_SAMPLES_FLAG_WHEEL:
+ *   [0..1] wheel position in detents, int16 little endian, wraps
+ *   [2..3] detents since the previous message, int16 little endian
+ *   [4..7] time of the last detent in ms, little endian, input event clock
+ * The block is repeated in a few messages after the wheel stops with 0
+ * detents since the previous message, so a lost message is corrected by the
+ * position of the next one.
+ * followed by a pointer block, only with PROTO_SAMPLES_FLAG_POINTER:
+ *   [0..1] smoothed x, 0..65535 across the screen, little endian
+ *   [2..3] smoothed y, 0..65535 down the screen, little endian
+ *   [4] 1 while the screen is touched
+ *   [5] reserved
+ * The block is sent in every message while the screen is touched and in a
+ * few more after the lift, so a lost lift does not leave the finger down.
+ * followed by a redundancy block, only with PROTO_SAMPLES_FLAG_REDUNDANT:
+ *   [0..1] sequence number of the first new sample, little endian, wraps
+ *   [2] number of repeated samples
+ *   [3] reserved
+ * followed by the repeated samples, oldest first, each:
+ *   [0..1] sequence number of the sample, little endian, wraps
+ *   accel only in the same encoding as below
+ * They are the newest samples the previous messages carried, so the phone
+ * can fill an isolated gap without asking again. Samples the watch skipped
+ * to keep up are never repeated.
+ * followed by count samples of:
+ *   [0..3] timestamp in ms, little endian, only with PROTO_SAMPLES_FLAG_TIMESTAMP
+ *   accel x, y, z in 1/100 m/s^2, int16 little endian, or with
+ *   PROTO_SAMPLES_FLAG_WIIMOTE Wiimote axes as 10 bit counts packed in a
+ *   uint32 little endian, x in bits 0..9, y in 10..19 and z in 20..29
+ *   gyro x, y, z in 1/10 deg/s, only if the gyro bit is set
+ */
+typedef enum {
+	PROTO_SAMPLES_FLAG_TIMESTAMP = 1 << 0,
+	PROTO_SAMPLES_FLAG_WHEEL = 1 << 1,
+	PROTO_SAMPLES_FLAG_POINTER = 1 << 2,
+	PROTO_SAMPLES_FLAG_WIIMOTE = 1 << 3,
+	PROTO_SAMPLES_FLAG_REDUNDANT = 1 << 4,
+} proto_samples_flag_e;
+
+#define PROTO_SAMPLES_HEADER_SIZE 4
+#define PROTO_SAMPLE_TS_SIZE 4
+#define PROTO_SAMPLE_AXES_SIZE 6
+#define PROTO_SAMPLE_WIIMOTE_SIZE 4
+#define PROTO_WHEEL_SIZE 8
+#define PROTO_POINTER_SIZE 6
+#define PROTO_REDUNDANT_SIZE 4
+#define PROTO_REPEAT_SEQ_SIZE 2
+#define PROTO_ACCEL_SCALE 100.0f
+#define PROTO_GYRO_SCALE 10.0f
+
+/*
+ * Bounds checked window into a received buffer. Views never own or copy
+ * the bytes, they are only valid while the SAP buffer is.
+ */
+typedef struct _proto_view {
+	const unsigned char *data;
+	unsigned int length;
+} proto_view_s;
+
+typedef struct _proto_msg {
+	proto_msg_type_e type;
+	proto_view_s body;
+} proto_msg_s;
+
+typedef enum {
+	PROTO_READ_OK,
+	PROTO_READ_END,
+	PROTO_READ_TRUNCATED,
+} proto_read_e;
+
+bool proto_is_typed(const void *buffer, unsigned int length);
+proto_read_e proto_read_message(proto_view_s *cursor, proto_msg_s *msg_out);
+
+static inline bool proto_get_u8(const proto_view_s *view, unsigned int offset, unsigned int *out)
+{
+	if (offset >= view->length)
+		return false;
+
+	*out = view->data[offset];
+	return true;
+}
+
+static inline bool proto_get_u16(const proto_view_s *view, unsigned int offset, unsigned int *out)
+{
+	if (view->length < 2 || offset > view->length - 2)
+		return false;
+
+	*out = view->data[offset] | (view->data[offset + 1] << 8);
+	return true;
+}
+
+/*
+ * Writers for outgoing messages, the caller checks the buffer size
+ */
+static inline void proto_put_u16(unsigned char *buf, unsigned int val)
+{
+	buf[0] = val & 0xff;
+	buf[1] = (val >> 8) & 0xff;
+}
+
+static inline void proto_put_u32(unsigned char *buf, unsigned int val)
+{
+	proto_put_u16(buf, val & 0xffff);
+	proto_put_u16(buf + 2, val >> 16);
+}
+
+static inline void proto_put_header(unsigned char *buf, proto_msg_type_e type, unsigned int body_len)
+{
+	buf[0] = PROTO_MAGIC;
+	buf[1] = type;
+	proto_put_u16(buf + 2, body_len);
+}
+
+#endif
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_RUMBLE_H)
+#define _RUMBLE_H
+
+#include <stdbool.h>
+#include "protocol.h"
+
+/* Longest a single start keeps the motor running without a refresh */
+#define RUMBLE_MAX_DURATION 1000
+/* Minimum gap between two haptic calls, faster changes are coalesced */
+#define RUMBLE_MIN_GAP 0.010
+/* Budget from message arrival to the motor call returning */
+#define RUMBLE_LATENCY_BUDGET 0.015
+
+/*
+ * Initialize the rumble component
+ */
+void rumble_initialize(void);
+
+/*
+ * Finalize the rumble component
+ */
+void rumble_finalize(void);
+
+bool rumble_is_supported(void);
+void rumble_handle_message(const proto_view_s *body, double arrival);
+void rumble_set(bool on, int intensity, int duration_ms, double arrival);
+void rumble_get_latency(double *avg_out, double *max_out);
+
+#endif
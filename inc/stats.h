@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_STATS_H)
+#define _STATS_H
+
+#include <stdbool.h>
+#include <Elementary.h>
+
+/* Overlay refresh period in seconds, the counters themselves are free running */
+#define STATS_REFRESH_INTERVAL 1.0
+/* Power of two buckets, the last one also takes everything above */
+#define STATS_BUCKETS 12
+/* Sends whose delivery status is tracked at the same time */
+#define STATS_INFLIGHT_MAX 32
+
+typedef enum {
+	STATS_SENSOR_WAKEUPS,
+	STATS_SENSOR_EVENTS,
+	STATS_KEY_PRESSES,
+	STATS_POLLS,
+	STATS_SENDS,
+	STATS_SEND_FAILURES,
+	STATS_DELIVERED,
+	STATS_COUNTER_MAX,
+} stats_counter_e;
+
+typedef enum {
+	STATS_HIST_DELIVERY_MS,		/* send to delivery status, ms */
+	STATS_HIST_QUEUE_DEPTH,		/* samples waiting when a message is built */
+	STATS_HIST_MAX,
+} stats_hist_e;
+
+/*
+ * Hot path recorders. They only do relaxed atomic increments, no locks,
+ * no allocation and no logging, so they are safe to call from any callback.
+ */
+void stats_count(stats_counter_e counter);
+void stats_record(stats_hist_e hist, unsigned int value);
+void stats_mark_sent(int transaction_id);
+void stats_mark_delivered(int transaction_id, bool delivered);
+
+/*
+ * On screen overlay in the main layout, toggled by double tapping the
+ * background or with the "stats_overlay" launch extra
+ */
+void stats_overlay_attach(Evas_Object *layout);
+void stats_overlay_set_visible(bool visible);
+void stats_overlay_detach(void);
+
+#endif
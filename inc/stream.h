@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_STREAM_H)
+#define _STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <app.h>
+#include "protocol.h"
+
+#define STREAM_RING_SIZE 64
+#define STREAM_BATCH_MAX 16
+#define STREAM_INTERVAL_MAX 1000
+#define STREAM_BATCH_LATENCY_MAX 1000
+#define STREAM_MESSAGE_MAX 1024
+#define STREAM_REDUNDANCY_MAX 8
+/* Heartbeats in a row before a full message is sent anyway */
+#define STREAM_IDLE_REFRESH 25
+/* Messages that still carry the wheel or pointer block after its last change */
+#define STREAM_BLOCK_REPEAT 4
+
+/* 0 lets the sensor framework pick its default interval */
+#define STREAM_DEFAULT_INTERVAL 0
+#define STREAM_DEFAULT_BATCH 1
+/* Batch latency value that turns hardware batching off */
+#define STREAM_BATCH_LATENCY_OFF 0xffff
+
+typedef enum {
+	STREAM_SENSOR_ACCEL = 1 << 0,
+	STREAM_SENSOR_GYRO = 1 << 1,
+	STREAM_SENSOR_ALL = STREAM_SENSOR_ACCEL | STREAM_SENSOR_GYRO,
+} stream_sensor_e;
+
+typedef enum {
+	STREAM_ENCODING_TEXT = 1,
+	STREAM_ENCODING_BINARY = 2,
+} stream_encoding_e;
+
+typedef enum {
+	STREAM_MODE_BUTTONS = 1,
+	STREAM_MODE_POINTER = 2,	/* touch drags drive the IR pointer */
+} stream_mode_e;
+
+/*
+ * Passed to stream_set_config() only the fields named in fields are applied,
+ * with fields 0 a zero field means "keep the current value"
+ */
+typedef struct _stream_config {
+	unsigned int interval_ms;
+	unsigned int batch_size;	/* 0 sends every pending sample up to STREAM_BATCH_MAX */
+	unsigned int sensors;
+	stream_encoding_e encoding;
+	stream_mode_e mode;
+	unsigned int batch_latency_ms;	/* sensor FIFO latency, STREAM_BATCH_LATENCY_OFF for none */
+	unsigned int fields;	/* proto_config_field_e */
+} stream_config_s;
+
+/*
+ * Initialize the stream component with the default configuration
+ */
+void stream_initialize(void);
+
+const stream_config_s *stream_get_config(void);
+bool stream_set_config(const stream_config_s *config);
+void stream_set_supported_sensors(unsigned int sensors);
+unsigned int stream_get_local_caps(void);
+void stream_set_config_from_app_control(app_control_h app_control);
+bool stream_parse_config(const proto_view_s *body, stream_config_s *config_out);
+int stream_build_config_ack(unsigned char *buf, int buf_size);
+bool stream_negotiate(const proto_view_s *body);
+int stream_build_hello_ack(unsigned char *buf, int buf_size);
+
+void stream_handle_redundancy(const proto_view_s *body);
+void stream_handle_deadband(const proto_view_s *body);
+void stream_set_decimation(unsigned int divider);
+bool stream_push_sample(stream_sensor_e sensor, unsigned long long timestamp, const float *values);
+void stream_push_wheel(int detents, unsigned int timestamp);
+void stream_push_pointer(float x, float y, bool touching);
+int stream_build_message(unsigned int keys, int key_count, unsigned char *buf, int buf_size);
+int stream_build_keys(unsigned int keys, int key_count, unsigned char *buf, int buf_size);
+size_t stream_memory(void);
+
+#endif
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.1 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://floralicense.org/license/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_THUMB_H)
+#define _THUMB_H
+
+#include <Elementary.h>
+
+/* Album art is decoded to the screen size, never larger */
+#define THUMB_SIZE 360
+/* Decoded thumbnails kept alive, and the bytes they may hold together */
+#define THUMB_CACHE_MAX 16
+#define THUMB_CACHE_BUDGET (3 * 1024 * 1024)
+
+/*
+ * Show an image file in an elm_image through the thumbnail cache. The
+ * image is set at once when its thumbnail is decoded already, otherwise it
+ * is decoded off the main loop and swapped in when ready.
+ */
+void thumb_set(Evas_Object *img, const char *image_path);
+
+/*
+ * Drop the decoded thumbnails nobody waits for, returns the bytes released
+ */
+size_t thumb_trim(void);
+size_t thumb_memory(void);
+
+/*
+ * Drop every decoded thumbnail and pending request
+ */
+void thumb_finalize(void);
+
+#endif
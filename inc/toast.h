@@ -0,0 +1,42 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#if !defined(_TOAST_H)
+#define _TOAST_H
+
+#include <Elementary.h>
+
+/* Seconds a toast stays up */
+#define TOAST_TIMEOUT 2.0
+/* The same text again within this many seconds of its show is dropped */
+#define TOAST_REPEAT_WINDOW 5.0
+/* Shortest time between two different texts, later ones wait for it */
+#define TOAST_MIN_INTERVAL 0.5
+#define TOAST_TEXT_SIZE 128
+
+/*
+ * Set the parent of the shared popup, created on the first toast
+ */
+void toast_initialize(Evas_Object *parent);
+
+/*
+ * Delete the popup and drop a toast still waiting
+ */
+void toast_finalize(void);
+
+void toast_show(const char *text);
+
+#endif
@@ -19,6 +19,7 @@
 
 #define EDJ_FILE "edje/hellomex.edj"
 #define GRP_MAIN "main"
+#define GRP_CONTROLLER_BUTTON "controller_button"
 
 Evas_Object *view_get_window(void);
 Evas_Object *view_get_conformant(void);
@@ -46,6 +47,8 @@ void view_set_progressbar(Evas_Object *parent, const char *part_name, int radius
 void view_set_progressbar_val(Evas_Object *parent, const char *part_name, int val);
 void view_set_button(Evas_Object *parent, const char *part_name, const char *style, const char *image_path, const char *text,
 		        Evas_Object_Event_Cb down_cb, Evas_Object_Event_Cb up_cb, Evas_Smart_Cb clicked_cb, void *user_data);
+void view_set_controller_button(Evas_Object *parent, const char *part_name, const char *file_path);
+void view_set_button_touch_callback(Evas_Object *parent, const char *part_name, Evas_Object_Event_Cb down_cb, Evas_Object_Event_Cb up_cb, void *user_data);
 void view_set_more_button(Evas_Object *parent, const char *part_name, Evas_Smart_Cb opened_cb, Evas_Smart_Cb closed_cb, Evas_Smart_Cb seleted_cb, void *user_data);
 void view_add_more_button_item(Evas_Object *parent, const char *part_name, const char *main_txt, const char *sub_txt, const char *image_path, Evas_Smart_Cb clicked_cb, void *user_data);
 
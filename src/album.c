@@ -0,0 +1,679 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.1 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://floralicense.org/license/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hellomex.h"
+#include "album.h"
+
+#define NO_ENTRY -1
+
+/*
+ * Entries live in one array and are reached through the order array, so
+ * the list index is O(1) and a removal only shifts integers. Strings are
+ * stored as offsets into a single arena, which keeps them valid across
+ * arena growth and lets the whole set go in one free. A chained hash on
+ * the file path finds an entry without string scans.
+ */
+typedef struct _album_entry {
+	int album_id;
+	unsigned int title;
+	unsigned int artist;
+	unsigned int album_art;
+	unsigned int file_path;
+	unsigned int hash;
+	int next;	/* next entry in the hash chain, or in the free list */
+} album_entry_s;
+
+#define CACHE_MAGIC 0x43424c41	/* "ALBC" */
+
+typedef struct _album_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t count;
+	uint32_t arena_size;
+	uint32_t media_count;
+	uint32_t reserved;
+	int64_t modified;
+} album_cache_header_s;
+
+typedef struct _album_cache_entry {
+	int32_t album_id;
+	uint32_t title;
+	uint32_t artist;
+	uint32_t album_art;
+	uint32_t file_path;
+} album_cache_entry_s;
+
+static struct _s_info {
+	album_entry_s *entries;
+	int entries_size;
+	int entries_used;
+	int free_entry;
+	int *order;
+	int count;
+	int *buckets;
+	unsigned int bucket_count;
+	char *arena;
+	size_t arena_size;
+	size_t arena_used;
+	size_t arena_garbage;
+} s_info = {
+	.entries = NULL,
+	.entries_size = 0,
+	.entries_used = 0,
+	.free_entry = NO_ENTRY,
+	.order = NULL,
+	.count = 0,
+	.buckets = NULL,
+	.bucket_count = 0,
+	.arena = NULL,
+	.arena_size = 0,
+	.arena_used = 0,
+	.arena_garbage = 0,
+};
+
+/* FNV-1a */
+static unsigned int _hash(const char *str)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static const char *_str(unsigned int offset)
+{
+	return s_info.arena + offset;
+}
+
+static size_t _entry_strings_size(const album_entry_s *entry)
+{
+	return strlen(_str(entry->title)) + strlen(_str(entry->artist)) + strlen(_str(entry->album_art)) + strlen(_str(entry->file_path)) + 4;
+}
+
+static bool _arena_reserve(size_t len)
+{
+	size_t size = s_info.arena_size ? s_info.arena_size : ALBUM_STORE_MIN_ARENA;
+	char *arena = NULL;
+
+	if (s_info.arena_used + len <= s_info.arena_size) {
+		return true;
+	}
+
+	while (size < s_info.arena_used + len) {
+		size *= 2;
+	}
+
+	arena = realloc(s_info.arena, size);
+	if (arena == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to grow the album arena to %zu bytes", size);
+		return false;
+	}
+
+	s_info.arena = arena;
+	s_info.arena_size = size;
+
+	return true;
+}
+
+/* The caller reserved the space */
+static unsigned int _arena_put(const char *str)
+{
+	unsigned int offset = s_info.arena_used;
+	size_t len = strlen(str) + 1;
+
+	memcpy(s_info.arena + offset, str, len);
+	s_info.arena_used += len;
+
+	return offset;
+}
+
+/*
+ * Copies the live strings into a fresh arena once removals and updates
+ * have left more garbage than live data
+ */
+static void _arena_compact(void)
+{
+	char *old = s_info.arena;
+	char *arena = NULL;
+	int i;
+
+	arena = malloc(s_info.arena_size);
+	if (arena == NULL) {
+		return;
+	}
+
+	s_info.arena = arena;
+	s_info.arena_used = 0;
+	s_info.arena_garbage = 0;
+
+	for (i = 0; i < s_info.count; i++) {
+		album_entry_s *entry = &s_info.entries[s_info.order[i]];
+
+		entry->title = _arena_put(old + entry->title);
+		entry->artist = _arena_put(old + entry->artist);
+		entry->album_art = _arena_put(old + entry->album_art);
+		entry->file_path = _arena_put(old + entry->file_path);
+	}
+
+	free(old);
+}
+
+static void _bucket_insert(int slot)
+{
+	int *bucket = &s_info.buckets[s_info.entries[slot].hash & (s_info.bucket_count - 1)];
+
+	s_info.entries[slot].next = *bucket;
+	*bucket = slot;
+}
+
+static bool _buckets_grow(void)
+{
+	unsigned int count = s_info.bucket_count ? s_info.bucket_count * 2 : ALBUM_STORE_MIN_ENTRIES;
+	int *buckets = NULL;
+	int i;
+
+	buckets = malloc(count * sizeof(*buckets));
+	if (buckets == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to grow the album hash");
+		return false;
+	}
+
+	free(s_info.buckets);
+	s_info.buckets = buckets;
+	s_info.bucket_count = count;
+	for (i = 0; i < (int)count; i++) {
+		s_info.buckets[i] = NO_ENTRY;
+	}
+
+	for (i = 0; i < s_info.count; i++) {
+		_bucket_insert(s_info.order[i]);
+	}
+
+	return true;
+}
+
+static bool _entries_reserve(void)
+{
+	int size = s_info.entries_size ? s_info.entries_size * 2 : ALBUM_STORE_MIN_ENTRIES;
+	album_entry_s *entries = NULL;
+	int *order = NULL;
+
+	if (s_info.free_entry != NO_ENTRY || s_info.entries_used < s_info.entries_size) {
+		return true;
+	}
+
+	entries = realloc(s_info.entries, size * sizeof(*entries));
+	if (entries == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to grow the album store");
+		return false;
+	}
+	s_info.entries = entries;
+
+	order = realloc(s_info.order, size * sizeof(*order));
+	if (order == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to grow the album order");
+		return false;
+	}
+	s_info.order = order;
+	s_info.entries_size = size;
+
+	return true;
+}
+
+static int _find_slot(const char *file_path, unsigned int hash)
+{
+	int slot;
+
+	if (s_info.bucket_count == 0) {
+		return NO_ENTRY;
+	}
+
+	for (slot = s_info.buckets[hash & (s_info.bucket_count - 1)]; slot != NO_ENTRY; slot = s_info.entries[slot].next) {
+		if (s_info.entries[slot].hash == hash && !strcmp(_str(s_info.entries[slot].file_path), file_path)) {
+			return slot;
+		}
+	}
+
+	return NO_ENTRY;
+}
+
+static int _order_index(int slot)
+{
+	int i;
+
+	for (i = 0; i < s_info.count; i++) {
+		if (s_info.order[i] == slot) {
+			return i;
+		}
+	}
+
+	return NO_ENTRY;
+}
+
+/*
+ * @brief: Release every album and the arena
+ */
+void album_store_clear(void)
+{
+	free(s_info.entries);
+	free(s_info.order);
+	free(s_info.buckets);
+	free(s_info.arena);
+
+	s_info.entries = NULL;
+	s_info.entries_size = 0;
+	s_info.entries_used = 0;
+	s_info.free_entry = NO_ENTRY;
+	s_info.order = NULL;
+	s_info.count = 0;
+	s_info.buckets = NULL;
+	s_info.bucket_count = 0;
+	s_info.arena = NULL;
+	s_info.arena_size = 0;
+	s_info.arena_used = 0;
+	s_info.arena_garbage = 0;
+}
+
+/*
+ * @brief: Append an album, or replace the one with the same file path in place
+ * @param[album_id]: Media DB album id
+ * @param[title], [artist], [album_art]: Copied into the arena, NULL is stored as "NULL"
+ * @param[file_path]: Copied into the arena, the key of the album, required
+ * Returns the list index of the album, or -1 on failure
+ */
+int album_store_add(int album_id, const char *title, const char *artist, const char *album_art, const char *file_path)
+{
+	album_entry_s *entry = NULL;
+	unsigned int hash = 0;
+	size_t len = 0;
+	int slot = NO_ENTRY;
+	int index = NO_ENTRY;
+
+	/* Albums without a track would all share one key and replace each other */
+	if (file_path == NULL || file_path[0] == '\0') {
+		dlog_print(DLOG_ERROR, LOG_TAG, "album %d has no file path, not stored", album_id);
+		return NO_ENTRY;
+	}
+
+	title = title ? title : "NULL";
+	artist = artist ? artist : "NULL";
+	album_art = album_art ? album_art : "NULL";
+
+	if (s_info.arena_garbage > s_info.arena_used / 2) {
+		_arena_compact();
+	}
+
+	hash = _hash(file_path);
+	slot = _find_slot(file_path, hash);
+	if (slot != NO_ENTRY) {
+		s_info.arena_garbage += _entry_strings_size(&s_info.entries[slot]);
+		index = _order_index(slot);
+	}
+
+	len = strlen(title) + strlen(artist) + strlen(album_art) + strlen(file_path) + 4;
+	if (!_arena_reserve(len)) {
+		return NO_ENTRY;
+	}
+
+	if (slot == NO_ENTRY) {
+		if (!_entries_reserve()) {
+			return NO_ENTRY;
+		}
+
+		if ((unsigned int)s_info.count >= s_info.bucket_count && !_buckets_grow()) {
+			return NO_ENTRY;
+		}
+
+		if (s_info.free_entry != NO_ENTRY) {
+			slot = s_info.free_entry;
+			s_info.free_entry = s_info.entries[slot].next;
+		} else {
+			slot = s_info.entries_used++;
+		}
+
+		s_info.entries[slot].hash = hash;
+		_bucket_insert(slot);
+		index = s_info.count;
+		s_info.order[s_info.count++] = slot;
+	}
+
+	entry = &s_info.entries[slot];
+	entry->album_id = album_id;
+	entry->title = _arena_put(title);
+	entry->artist = _arena_put(artist);
+	entry->album_art = _arena_put(album_art);
+	entry->file_path = _arena_put(file_path);
+
+	return index;
+}
+
+/*
+ * @brief: Remove the album of a file path
+ * @param[file_path]: File path of music
+ * Returns false if no album has that path
+ */
+bool album_store_remove(const char *file_path)
+{
+	unsigned int hash = 0;
+	int slot = NO_ENTRY;
+	int index = NO_ENTRY;
+	int *link = NULL;
+
+	if (file_path == NULL) {
+		return false;
+	}
+
+	hash = _hash(file_path);
+	slot = _find_slot(file_path, hash);
+	if (slot == NO_ENTRY) {
+		return false;
+	}
+
+	for (link = &s_info.buckets[hash & (s_info.bucket_count - 1)]; *link != slot; link = &s_info.entries[*link].next)
+		;
+	*link = s_info.entries[slot].next;
+
+	index = _order_index(slot);
+	memmove(&s_info.order[index], &s_info.order[index + 1], (s_info.count - index - 1) * sizeof(*s_info.order));
+	s_info.count--;
+
+	s_info.arena_garbage += _entry_strings_size(&s_info.entries[slot]);
+	s_info.entries[slot].next = s_info.free_entry;
+	s_info.free_entry = slot;
+
+	return true;
+}
+
+/*
+ * @brief: Get the list index of the album of a file path, or -1
+ */
+int album_store_find(const char *file_path)
+{
+	int slot = NO_ENTRY;
+
+	if (file_path == NULL) {
+		return NO_ENTRY;
+	}
+
+	slot = _find_slot(file_path, _hash(file_path));
+
+	return slot == NO_ENTRY ? NO_ENTRY : _order_index(slot);
+}
+
+/*
+ * @brief: Get the list index of an album by its media DB id, or -1
+ */
+int album_store_find_album(int album_id)
+{
+	int i;
+
+	for (i = 0; i < s_info.count; i++) {
+		if (s_info.entries[s_info.order[i]].album_id == album_id) {
+			return i;
+		}
+	}
+
+	return NO_ENTRY;
+}
+
+int album_store_count(void)
+{
+	return s_info.count;
+}
+
+/*
+ * @brief: Get a borrowed view of an album by list index
+ * @param[index]: Index in album list
+ * @param[info]: Filled on success
+ */
+bool album_store_get(int index, album_info_s *info)
+{
+	const album_entry_s *entry = NULL;
+
+	if (index < 0 || index >= s_info.count) {
+		return false;
+	}
+
+	entry = &s_info.entries[s_info.order[index]];
+	info->album_id = entry->album_id;
+	info->title = _str(entry->title);
+	info->artist = _str(entry->artist);
+	info->album_art = _str(entry->album_art);
+	info->file_path = _str(entry->file_path);
+
+	return true;
+}
+
+/*
+ * @brief: Bytes held by the store
+ */
+size_t album_store_memory(void)
+{
+	return s_info.entries_size * (sizeof(album_entry_s) + sizeof(int)) + s_info.bucket_count * sizeof(int) + s_info.arena_size;
+}
+
+/*
+ * @brief: Write the store to a cache file
+ * @param[path]: Cache file, replaced atomically through a temporary file
+ * @param[stamp]: Media DB state the albums were read from
+ */
+bool album_store_save(const char *path, const album_stamp_s *stamp)
+{
+	album_cache_header_s header = { 0, };
+	char tmp_path[PATH_MAX] = { 0, };
+	FILE *fp = NULL;
+	bool ok = true;
+	int i;
+
+	if (s_info.arena_garbage) {
+		_arena_compact();
+	}
+
+	header.magic = CACHE_MAGIC;
+	header.version = ALBUM_CACHE_VERSION;
+	header.count = s_info.count;
+	header.arena_size = s_info.arena_used;
+	header.media_count = stamp->media_count;
+	header.modified = stamp->modified;
+
+	snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+	fp = fopen(tmp_path, "wb");
+	if (fp == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to open %s", tmp_path);
+		return false;
+	}
+
+	ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+	for (i = 0; ok && i < s_info.count; i++) {
+		const album_entry_s *entry = &s_info.entries[s_info.order[i]];
+		album_cache_entry_s out = {
+			.album_id = entry->album_id,
+			.title = entry->title,
+			.artist = entry->artist,
+			.album_art = entry->album_art,
+			.file_path = entry->file_path,
+		};
+
+		ok = fwrite(&out, sizeof(out), 1, fp) == 1;
+	}
+
+	if (ok && s_info.arena_used) {
+		ok = fwrite(s_info.arena, s_info.arena_used, 1, fp) == 1;
+	}
+
+	if (fclose(fp) != 0) {
+		ok = false;
+	}
+
+	if (!ok || rename(tmp_path, path) != 0) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to write the album cache %s", path);
+		unlink(tmp_path);
+		return false;
+	}
+
+	return true;
+}
+
+static bool _cache_valid(const unsigned char *map, size_t size)
+{
+	const album_cache_header_s *header = (const album_cache_header_s *)map;
+	const album_cache_entry_s *entries = (const album_cache_entry_s *)(map + sizeof(*header));
+	const char *arena = NULL;
+	uint32_t i;
+
+	if (size < sizeof(*header) || header->magic != CACHE_MAGIC || header->version != ALBUM_CACHE_VERSION) {
+		return false;
+	}
+
+	if (header->count > (size - sizeof(*header)) / sizeof(*entries)
+			|| sizeof(*header) + header->count * sizeof(*entries) + header->arena_size != size) {
+		return false;
+	}
+
+	arena = (const char *)(entries + header->count);
+	if (header->arena_size && arena[header->arena_size - 1] != '\0') {
+		return false;
+	}
+
+	for (i = 0; i < header->count; i++) {
+		if (entries[i].title >= header->arena_size || entries[i].artist >= header->arena_size
+				|| entries[i].album_art >= header->arena_size || entries[i].file_path >= header->arena_size) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * Copies a validated cache image into an empty store
+ */
+static bool _load_image(const unsigned char *map)
+{
+	const album_cache_header_s *header = (const album_cache_header_s *)map;
+	const album_cache_entry_s *entries = (const album_cache_entry_s *)(map + sizeof(*header));
+	int size = ALBUM_STORE_MIN_ENTRIES;
+	int i;
+
+	while (size < (int)header->count) {
+		size *= 2;
+	}
+
+	s_info.arena_size = ALBUM_STORE_MIN_ARENA;
+	while (s_info.arena_size < header->arena_size) {
+		s_info.arena_size *= 2;
+	}
+
+	s_info.entries = malloc(size * sizeof(*s_info.entries));
+	s_info.order = malloc(size * sizeof(*s_info.order));
+	s_info.arena = malloc(s_info.arena_size);
+	if (s_info.entries == NULL || s_info.order == NULL || s_info.arena == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to allocate the album store");
+		return false;
+	}
+
+	s_info.entries_size = size;
+	memcpy(s_info.arena, entries + header->count, header->arena_size);
+	s_info.arena_used = header->arena_size;
+
+	for (i = 0; i < (int)header->count; i++) {
+		album_entry_s *entry = &s_info.entries[i];
+
+		entry->album_id = entries[i].album_id;
+		entry->title = entries[i].title;
+		entry->artist = entries[i].artist;
+		entry->album_art = entries[i].album_art;
+		entry->file_path = entries[i].file_path;
+		entry->hash = _hash(_str(entry->file_path));
+		s_info.order[i] = i;
+	}
+	s_info.entries_used = header->count;
+	s_info.count = header->count;
+
+	while (s_info.bucket_count <= (unsigned int)s_info.count) {
+		if (!_buckets_grow()) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+ * @brief: Replace the store with the contents of a cache file
+ * @param[path]: Cache file
+ * @param[stamp]: Media DB state the cache was written against
+ * Returns false if the file is missing or invalid, the store is then empty
+ */
+bool album_store_load(const char *path, album_stamp_s *stamp)
+{
+	const album_cache_header_s *header = NULL;
+	unsigned char *map = NULL;
+	struct stat st;
+	bool ok = false;
+	int fd = -1;
+
+	album_store_clear();
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to map the album cache %s", path);
+		return false;
+	}
+
+	if (_cache_valid(map, st.st_size)) {
+		ok = _load_image(map);
+		if (!ok) {
+			album_store_clear();
+		}
+	} else {
+		dlog_print(DLOG_ERROR, LOG_TAG, "album cache %s is invalid", path);
+	}
+
+	if (ok) {
+		header = (const album_cache_header_s *)map;
+		stamp->media_count = header->media_count;
+		stamp->modified = header->modified;
+	}
+
+	munmap(map, st.st_size);
+
+	return ok;
+}
@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include <app_preference.h>
+#include "hellomex.h"
+#include "calib.h"
+#include "logger.h"
+
+#define STANDARD_GRAVITY 9.80665f
+/* Accepted one-g reference, anything outside is a bad capture */
+#define ONE_G_MIN 7.0f
+#define ONE_G_MAX 13.0f
+
+/*
+ * The sample path works on Q8 m/s^2 readings and a matrix scaled by 2^8,
+ * so a row sum lands in Q16 Wiimote counts. Inputs are clamped to
+ * +-128 m/s^2 which keeps every row sum inside 32 bits.
+ */
+#define INPUT_SHIFT 8
+#define INPUT_MAX 32767
+#define OUTPUT_SHIFT 16
+
+static const char *pref_keys[2][3] = {
+	{ "calib_zero_x", "calib_zero_y", "calib_zero_z" },
+	{ "calib_one_g_x", "calib_one_g_y", "calib_one_g_z" },
+};
+
+/*
+ * Watch axes to Wiimote axes. The watch reports x to the right of the
+ * screen, y towards 12 o'clock and z out of the screen, the Wiimote
+ * reports x to the left, y towards the IR camera and z out of the buttons.
+ */
+static const float axis_map[3][3] = {
+	{ -1.0f, 0.0f, 0.0f },
+	{ 0.0f, 1.0f, 0.0f },
+	{ 0.0f, 0.0f, 1.0f },
+};
+
+static struct _s_info {
+	/* References in m/s^2, per watch axis */
+	float zero[3];
+	float one_g[3];
+	/* Precomputed conversion */
+	int matrix[3][3];
+	int offset[3];
+	/* Capture in progress */
+	calib_step_e step;
+	unsigned int captured;
+	unsigned int seen;
+	float sum[3];
+	float min[3];
+	float max[3];
+	float face_up[3];
+	bool have_face_up;
+	/* Result of the last step, for calib_build_message() */
+	calib_step_e last_step;
+	calib_status_e last_status;
+} s_info = {
+	.zero = { 0.0f, 0.0f, 0.0f },
+	.one_g = { STANDARD_GRAVITY, STANDARD_GRAVITY, STANDARD_GRAVITY },
+	.step = 0,
+	.have_face_up = false,
+};
+
+static void _precompute(void)
+{
+	float counts_per_g = CALIB_WIIMOTE_ONE_G - CALIB_WIIMOTE_ZERO_G;
+	int i;
+	int j;
+
+	for (i = 0; i < 3; i++) {
+		float offset = CALIB_WIIMOTE_ZERO_G;
+
+		for (j = 0; j < 3; j++) {
+			float w = axis_map[i][j] * counts_per_g / s_info.one_g[j];
+
+			s_info.matrix[i][j] = (int)(w * (1 << (OUTPUT_SHIFT - INPUT_SHIFT)) + (w < 0.0f ? -0.5f : 0.5f));
+			offset -= w * s_info.zero[j];
+		}
+		s_info.offset[i] = (int)(offset * (1 << OUTPUT_SHIFT));
+	}
+}
+
+static void _store(void)
+{
+	int ret = 0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		ret |= preference_set_double(pref_keys[0][i], s_info.zero[i]);
+		ret |= preference_set_double(pref_keys[1][i], s_info.one_g[i]);
+	}
+
+	if (ret != PREFERENCE_ERROR_NONE)
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to store the calibration");
+}
+
+static void _start_capture(calib_step_e step)
+{
+	int i;
+
+	s_info.step = step;
+	s_info.captured = 0;
+	s_info.seen = 0;
+	for (i = 0; i < 3; i++)
+		s_info.sum[i] = 0.0f;
+}
+
+static calib_status_e _finish_capture(const float *mean)
+{
+	float zero[3];
+	float one_g[3];
+	int i;
+
+	memcpy(zero, s_info.zero, sizeof(zero));
+	memcpy(one_g, s_info.one_g, sizeof(one_g));
+
+	if (s_info.step == CALIB_STEP_FACE_UP) {
+		zero[0] = mean[0];
+		zero[1] = mean[1];
+		one_g[2] = mean[2] - zero[2];
+		memcpy(s_info.face_up, mean, sizeof(s_info.face_up));
+		s_info.have_face_up = true;
+	} else if (s_info.have_face_up) {
+		/* Both sides seen, the z offset and scale no longer need guessing */
+		zero[0] = (s_info.face_up[0] + mean[0]) / 2.0f;
+		zero[1] = (s_info.face_up[1] + mean[1]) / 2.0f;
+		zero[2] = (s_info.face_up[2] + mean[2]) / 2.0f;
+		one_g[2] = (s_info.face_up[2] - mean[2]) / 2.0f;
+	} else {
+		one_g[2] = zero[2] - mean[2];
+	}
+
+	if (one_g[2] < ONE_G_MIN || one_g[2] > ONE_G_MAX) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "calibration rejected, one-g reference %f", one_g[2]);
+		return CALIB_STATUS_OUT_OF_RANGE;
+	}
+
+	/* Only z sees gravity in either pose, x and y share its scale */
+	one_g[0] = one_g[2];
+	one_g[1] = one_g[2];
+	for (i = 0; i < 3; i++) {
+		s_info.zero[i] = zero[i];
+		s_info.one_g[i] = one_g[i];
+	}
+
+	_precompute();
+	_store();
+
+	LOGGER_I(LOG_TAG, "calibration: zero %f %f %f, one-g %f",
+			zero[0], zero[1], zero[2], one_g[2]);
+
+	return CALIB_STATUS_DONE;
+}
+
+/*
+ * @brief: Load the stored references and precompute the conversion
+ */
+void calib_initialize(void)
+{
+	double value = 0.0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		if (preference_get_double(pref_keys[0][i], &value) == PREFERENCE_ERROR_NONE)
+			s_info.zero[i] = value;
+		if (preference_get_double(pref_keys[1][i], &value) == PREFERENCE_ERROR_NONE && value >= ONE_G_MIN && value <= ONE_G_MAX)
+			s_info.one_g[i] = value;
+	}
+
+	s_info.step = 0;
+	_precompute();
+}
+
+/*
+ * @brief: Handle a calibrate message from the phone
+ * @param[body]: Body of a PROTO_MSG_CALIBRATE message
+ * Captures start with the next accelerometer reading, the result is
+ * reported once calib_feed() returns true.
+ */
+void calib_handle_message(const proto_view_s *body)
+{
+	unsigned int step = 0;
+	int i;
+
+	if (!proto_get_u8(body, 0, &step)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "short calibrate message (%u)", body->length);
+		return;
+	}
+
+	switch (step) {
+	case CALIB_STEP_FACE_UP:
+	case CALIB_STEP_FACE_DOWN:
+		_start_capture(step);
+		break;
+
+	case CALIB_STEP_RESET:
+		for (i = 0; i < 3; i++) {
+			s_info.zero[i] = 0.0f;
+			s_info.one_g[i] = STANDARD_GRAVITY;
+		}
+		s_info.step = 0;
+		s_info.have_face_up = false;
+		_precompute();
+		_store();
+		break;
+
+	default:
+		dlog_print(DLOG_ERROR, LOG_TAG, "unknown calibration step %u", step);
+		break;
+	}
+}
+
+/*
+ * @brief: Feed one accelerometer reading to a running capture
+ * @param[accel]: x, y and z in m/s^2
+ * Returns true when a capture just finished and its result should be sent
+ */
+bool calib_feed(const float *accel)
+{
+	float mean[3];
+	int i;
+
+	if (!s_info.step) {
+		return false;
+	}
+
+	s_info.seen++;
+	for (i = 0; i < 3; i++) {
+		if (s_info.captured == 0 || accel[i] < s_info.min[i])
+			s_info.min[i] = accel[i];
+		if (s_info.captured == 0 || accel[i] > s_info.max[i])
+			s_info.max[i] = accel[i];
+		s_info.sum[i] += accel[i];
+	}
+	s_info.captured++;
+
+	for (i = 0; i < 3; i++) {
+		if (s_info.max[i] - s_info.min[i] > CALIB_STEADY_RANGE)
+			break;
+	}
+
+	if (i < 3) {
+		/* Moved, start over from this reading until the watch settles */
+		if (s_info.seen >= CALIB_CAPTURE_MAX) {
+			s_info.last_step = s_info.step;
+			s_info.last_status = CALIB_STATUS_UNSTEADY;
+			s_info.step = 0;
+			return true;
+		}
+		for (i = 0; i < 3; i++) {
+			s_info.sum[i] = accel[i];
+			s_info.min[i] = accel[i];
+			s_info.max[i] = accel[i];
+		}
+		s_info.captured = 1;
+		return false;
+	}
+
+	if (s_info.captured < CALIB_CAPTURE_SAMPLES) {
+		return false;
+	}
+
+	for (i = 0; i < 3; i++)
+		mean[i] = s_info.sum[i] / s_info.captured;
+
+	s_info.last_step = s_info.step;
+	s_info.last_status = _finish_capture(mean);
+	s_info.step = 0;
+
+	return true;
+}
+
+/*
+ * @brief: Encode the result of the last capture as a PROTO_MSG_CALIBRATION message
+ * @param[buf]: Output buffer
+ * @param[buf_size]: Size of the output buffer
+ * Returns the message length or 0 if the buffer is too small
+ */
+int calib_build_message(unsigned char *buf, int buf_size)
+{
+	unsigned char *body = buf + PROTO_HEADER_SIZE;
+
+	if (buf_size < PROTO_HEADER_SIZE + PROTO_CALIBRATION_SIZE) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_CALIBRATION, PROTO_CALIBRATION_SIZE);
+	body[0] = s_info.last_step;
+	body[1] = s_info.last_status;
+	proto_put_u16(body + 2, CALIB_WIIMOTE_ZERO_G);
+	proto_put_u16(body + 4, CALIB_WIIMOTE_ONE_G);
+
+	return PROTO_HEADER_SIZE + PROTO_CALIBRATION_SIZE;
+}
+
+/*
+ * @brief: Convert a reading to Wiimote counts with the precomputed matrix
+ * @param[accel]: x, y and z in m/s^2
+ */
+unsigned int calib_to_wiimote(const float *accel)
+{
+	int in[3];
+	unsigned int packed = 0;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		float v = accel[i] * (1 << INPUT_SHIFT);
+
+		if (v > INPUT_MAX)
+			v = INPUT_MAX;
+		else if (v < -INPUT_MAX)
+			v = -INPUT_MAX;
+		in[i] = (int)v;
+	}
+
+	for (i = 0; i < 3; i++) {
+		int acc = s_info.offset[i] + (1 << (OUTPUT_SHIFT - 1));
+		int count = 0;
+
+		acc += s_info.matrix[i][0] * in[0];
+		acc += s_info.matrix[i][1] * in[1];
+		acc += s_info.matrix[i][2] * in[2];
+		count = acc >> OUTPUT_SHIFT;
+
+		if (count < 0)
+			count = 0;
+		else if (count > CALIB_WIIMOTE_MAX)
+			count = CALIB_WIIMOTE_MAX;
+		packed |= (unsigned int)count << (i * 10);
+	}
+
+	return packed;
+}
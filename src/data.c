@@ -14,22 +14,45 @@
  * limitations under the License.
  */
 
+#include <stdint.h>
+#include <strings.h>
 #include <dlog.h>
 #include <efl_extension.h>
 #include <app_common.h>
 #include <media_content.h>
+#include "album.h"
 #include "data.h"
 #include "hellomex.h"
+#include "logger.h"
+#include "view.h"
 
+/* Filled while the media DB is walked, then copied into the album store */
 typedef struct _album_data {
 	int album_id;
 	char *title;
 	char *artist;
 	char *album_art;
 	char *file_path;
-	audio_meta_h audio;
+	bool own_query;	/* no name of its own, its music is read by album id */
 } album_data_s;
 
+/* Albums of one enumeration, looked up by name while the music rows stream in */
+typedef struct _album_scan {
+	album_data_s *albums;
+	int count;
+	int size;
+	Eina_Hash *by_name;	/* album name -> index + 1, or SCAN_SHARED_NAME */
+} album_scan_s;
+
+/* by_name value of a name more than one album has */
+#define SCAN_SHARED_NAME -1
+
+/* Album list cache in the app data directory */
+#define DATA_ALBUM_CACHE "albums.cache"
+
+/* Room for the album query condition of one changed item */
+#define DATA_ALBUM_CONDITION_MAX 512
+
 typedef struct _more_btn_data {
 	char *main_txt;
 	char *sub_txt;
@@ -41,20 +64,105 @@ static more_btn_data_s more_btn_item[DEVICE_INFO_MAX] = {
 	{ "Play music from:", "Phone", "images/More_option/music_more_opt_select_device_mobile.png" },
 };
 
+/*
+ * Relative path of every registry entry. The table is resolved against the
+ * resource directory in one go, into a single block that lives until
+ * data_destroy_resources(), so lookups are an index and never allocate.
+ */
+static const char *resource_file[DATA_RESOURCE_MAX] = {
+	[DATA_RESOURCE_EDJ] = EDJ_FILE,
+	[DATA_RESOURCE_DEVICE_GEAR] = "images/Controller/music_gear.png",
+	[DATA_RESOURCE_DEVICE_PHONE] = "images/Controller/music_device.png",
+};
+
 static struct _s_info {
 	filter_h filter;
-	media_info_h media_info;
-	Eina_List *list;
+	filter_h media_filter;
+	bool watching;
+	char *cache_path;
+	album_stamp_s cache_stamp;	/* DB state the album store reflects */
+	bool cache_stamp_known;
+	bool cache_dirty;
+	Ecore_Idler *cache_idler;
+	char *res_path;
+	char *resource_block;
+	const char *resource[DATA_RESOURCE_MAX];
 } s_info = {
 	.filter = NULL,
-	.list = NULL,
+	.media_filter = NULL,
+	.watching = false,
+	.cache_path = NULL,
+	.cache_stamp_known = false,
+	.cache_dirty = false,
+	.cache_idler = NULL,
+	.res_path = NULL,
+	.resource_block = NULL,
 };
 
-static void _destroy_media_info(void);
 static void _destroy_media_filter(void);
 static void _create_media_filter(void);
 static bool _media_item_cb(media_info_h media, void *user_data);
+static bool _album_media_cb(media_info_h media, void *user_data);
 static bool _album_list_cb(media_album_h album, void *user_data);
+static void _watch_media_db(bool watch);
+static void _save_album_cache(void);
+static bool _read_db_stamp(album_stamp_s *stamp);
+static const char *_get_album_cache_path(void);
+
+static void _free_album_data(album_data_s *album_data)
+{
+	free(album_data->title);
+	free(album_data->artist);
+	free(album_data->album_art);
+	free(album_data->file_path);
+}
+
+/*
+ * Returns the resource directory, asked from the framework only once
+ */
+static const char *_get_res_path(void)
+{
+	if (s_info.res_path == NULL) {
+		s_info.res_path = app_get_resource_path();
+		if (s_info.res_path == NULL) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "failed to get the resource path.");
+		}
+	}
+
+	return s_info.res_path;
+}
+
+static bool _resolve_resources(void)
+{
+	const char *res_path = _get_res_path();
+	size_t res_len = 0;
+	size_t size = 0;
+	char *p = NULL;
+	int i;
+
+	if (res_path == NULL) {
+		return false;
+	}
+
+	res_len = strlen(res_path);
+	for (i = 0; i < DATA_RESOURCE_MAX; i++) {
+		size += res_len + strlen(resource_file[i]) + 1;
+	}
+
+	s_info.resource_block = malloc(size);
+	if (s_info.resource_block == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to allocate the resource paths.");
+		return false;
+	}
+
+	p = s_info.resource_block;
+	for (i = 0; i < DATA_RESOURCE_MAX; i++) {
+		s_info.resource[i] = p;
+		p += sprintf(p, "%s%s", res_path, resource_file[i]) + 1;
+	}
+
+	return true;
+}
 
 /*
  * @brief: Get path of resource
@@ -64,13 +172,44 @@ static bool _album_list_cb(media_album_h album, void *user_data);
  */
 void data_get_resource_path(const char *file_in, char *file_path_out, int file_path_max)
 {
-	char *res_path = app_get_resource_path();
+	const char *res_path = _get_res_path();
 	if (res_path) {
 		snprintf(file_path_out, file_path_max, "%s%s", res_path, file_in);
-		free(res_path);
 	}
 }
 
+/*
+ * @brief: Get the full path of a registry entry
+ * @param[resource]: Entry
+ * The string is borrowed, it stays valid until data_destroy_resources().
+ */
+const char *data_get_resource(data_resource_e resource)
+{
+	if (resource < 0 || resource >= DATA_RESOURCE_MAX) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "unknown resource %d.", resource);
+		return NULL;
+	}
+
+	if (s_info.resource_block == NULL && !_resolve_resources()) {
+		return NULL;
+	}
+
+	return s_info.resource[resource];
+}
+
+/*
+ * @brief: Release the resolved resource paths
+ */
+void data_destroy_resources(void)
+{
+	free(s_info.resource_block);
+	s_info.resource_block = NULL;
+	memset(s_info.resource, 0, sizeof(s_info.resource));
+
+	free(s_info.res_path);
+	s_info.res_path = NULL;
+}
+
 /*
  * @brief: Initialization function for data module
  */
@@ -84,115 +223,68 @@ void data_initialize(void)
 
 
 /*
- * @brief: Get album list
+ * @brief: Get the number of albums
  */
-Eina_List *data_get_album_list(void)
+int data_get_album_count(void)
 {
-	return s_info.list;
+	return album_store_count();
 }
 
 /*
  * @brief: Get album title by index
- * @param[list]: List that contains album information
  * @param[index]: Index in album list
  */
-char *data_get_album_title(Eina_List *list, int index)
+const char *data_get_album_title(int index)
 {
-	album_data_s *album_data = eina_list_nth(list, index);
-	return album_data->title;
+	album_info_s info;
+
+	return album_store_get(index, &info) ? info.title : NULL;
 }
 
 /*
  * @brief: Get album artist by index
- * @param[list]: List that contains album information
  * @param[index]: Index in album list
  */
-char *data_get_album_artist(Eina_List *list, int index)
+const char *data_get_album_artist(int index)
 {
-	album_data_s *album_data = eina_list_nth(list, index);
-	return album_data->artist;
+	album_info_s info;
+
+	return album_store_get(index, &info) ? info.artist : NULL;
 }
 
 /*
  * @brief: Get album art by index
- * @param[list]: List that contains album information
  * @param[index]: Index in album list
  */
-char *data_get_album_art(Eina_List *list, int index)
+const char *data_get_album_art(int index)
 {
-	album_data_s *album_data = eina_list_nth(list, index);
-	return album_data->album_art;
+	album_info_s info;
+
+	return album_store_get(index, &info) ? info.album_art : NULL;
 }
 
 /*
  * @brief: Get album file path by index
- * @param[list]: List that contains album information
  * @param[index]: Index in album list
  */
-char *data_get_album_file_path(Eina_List *list, int index)
+const char *data_get_album_file_path(int index)
 {
-	album_data_s *album_data = eina_list_nth(list, index);
-	return album_data->file_path;
+	album_info_s info;
+
+	return album_store_get(index, &info) ? info.file_path : NULL;
 }
 
 /*
  * @brief: Get device icon image
  * @param[device]: Device type to display
  */
-char *data_get_device_image(device_info_e device)
+const char *data_get_device_image(device_info_e device)
 {
-	char *file_path = NULL;
-	char full_path[PATH_MAX] = { 0, };
-
 	if (device == DEVICE_INFO_GEAR) {
-		file_path = "images/Controller/music_gear.png";
-	} else {
-		file_path = "images/Controller/music_device.png";
-	}
-
-	data_get_resource_path(file_path, full_path, (int)PATH_MAX);
-
-	return strdup(full_path);
-}
-
-/*
- * @brief: Get a image path
- * @param[part_name]: Part name to which you want to set
- */
-char *data_get_image(const char *part_name)
-{
-	/*
-	 * You can use this function to retrieve data.
-	 */
-	char *file_path = NULL;
-	char full_path[PATH_MAX] = { 0, };
-
-	if (!strcmp("left_arrow", part_name)) {
-		file_path = "images/Controller/left_arrow.png";
-	}
-	else if (!strcmp("right_arrow", part_name)) {
-		file_path = "images/Controller/right_arrow.png";
+		return data_get_resource(DATA_RESOURCE_DEVICE_GEAR);
 	}
-	else if (!strcmp("up_arrow", part_name)) {
-		file_path = "images/Controller/up_arrow.png";
-	}
-	else if (!strcmp("down_arrow", part_name)) {
-		file_path = "images/Controller/down_arrow.png";
-	}
-	else if (!strcmp("a_btn", part_name)) {
-		file_path = "images/Controller/a_btn.png";
-	}
-	else if (!strcmp("b_btn", part_name)) {
-		file_path = "images/Controller/b_btn.png";
-	}
-	else {
-		dlog_print(DLOG_ERROR, LOG_TAG, "failed to get image.");
-		return NULL;
-	}
-
-	data_get_resource_path(file_path, full_path, (int)PATH_MAX);
 
-	return strdup(full_path);
+	return data_get_resource(DATA_RESOURCE_DEVICE_PHONE);
 }
 
 /*
@@ -227,271 +319,691 @@ char *data_get_more_button_image(int index)
  */
 void data_destroy_album_list(void)
 {
-	album_data_s *album_data = NULL;
+	if (s_info.cache_idler) {
+		ecore_idler_del(s_info.cache_idler);
+		s_info.cache_idler = NULL;
+	}
 
-	EINA_LIST_FREE(s_info.list, album_data) {
-		free(album_data->title);
-		free(album_data->artist);
-		free(album_data->album_art);
-		free(album_data->file_path);
+	_watch_media_db(false);
+	if (s_info.cache_dirty) {
+		_save_album_cache();
 	}
+	album_store_clear();
+	s_info.cache_stamp_known = false;
+	s_info.cache_dirty = false;
 
-	s_info.list = NULL;
+	free(s_info.cache_path);
+	s_info.cache_path = NULL;
 
 	_destroy_media_filter();
-	_destroy_media_info();
 }
 
 /*
- * @brief: Iterates through the media album with optional filter from the media database
+ * @brief: Reads the albums, then every music item in one query grouped by album
+ * Only albums without a name of their own cost a query each.
+ * Returns the number of albums, or -1 on failure
  */
-Eina_List *data_create_album_list(void)
+static int _enumerate_albums(void)
 {
+	album_scan_s scan = { 0, };
+	album_stamp_s stamp = { 0, };
+	bool stamp_known = false;
 	int ret = MEDIA_CONTENT_ERROR_NONE;
+	int i;
 
 	if (s_info.filter == NULL) {
 		_create_media_filter();
 	}
 
-	ret = media_album_foreach_album_from_db(s_info.filter, _album_list_cb, NULL);
-	if (ret != MEDIA_CONTENT_ERROR_NONE) {
+	if (s_info.filter == NULL || s_info.media_filter == NULL) {
+		return -1;
+	}
+
+	scan.by_name = eina_hash_string_superfast_new(NULL);
+	if (scan.by_name == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to create the album index");
+		return -1;
+	}
+
+	/* Read first, a change made while the queries run must make the cache look stale */
+	stamp_known = _read_db_stamp(&stamp);
+
+	ret = media_album_foreach_album_from_db(s_info.filter, _album_list_cb, &scan);
+	if (ret == MEDIA_CONTENT_ERROR_NONE) {
+		ret = media_info_foreach_media_from_db(s_info.media_filter, _media_item_cb, &scan);
+	}
+
+	/* A music row only names its album, so albums sharing a name are read one by one */
+	for (i = 0; i < scan.count && ret == MEDIA_CONTENT_ERROR_NONE; i++) {
+		if (scan.albums[i].own_query)
+			ret = media_album_foreach_media_from_db(scan.albums[i].album_id, s_info.filter, _album_media_cb, &scan.albums[i]);
+	}
+
+	if (ret == MEDIA_CONTENT_ERROR_NONE) {
+		for (i = 0; i < scan.count; i++) {
+			album_data_s *album_data = &scan.albums[i];
+
+			/* No music left in the album */
+			if (album_data->file_path == NULL)
+				continue;
+
+			LOGGER_D(LOG_TAG, "[%d] %s - %s (%s, %s)", album_data->album_id, album_data->title, album_data->artist, album_data->album_art, album_data->file_path);
+			album_store_add(album_data->album_id, album_data->title, album_data->artist, album_data->album_art, album_data->file_path);
+		}
+	} else {
+		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] album query error: %d", __FILE__, __LINE__, ret);
 		_destroy_media_filter();
-		return NULL;
 	}
 
-	return s_info.list;
+	for (i = 0; i < scan.count; i++) {
+		_free_album_data(&scan.albums[i]);
+	}
+	free(scan.albums);
+	eina_hash_free(scan.by_name);
+
+	if (ret != MEDIA_CONTENT_ERROR_NONE) {
+		return -1;
+	}
+
+	s_info.cache_stamp = stamp;
+	s_info.cache_stamp_known = stamp_known;
+	s_info.cache_dirty = true;
+	_save_album_cache();
+
+	/* Later changes are applied as they come */
+	_watch_media_db(true);
+
+	return album_store_count();
 }
 
 /*
- * @brief: Update album list data
+ * @brief: Checks a cache loaded at startup against the media DB, from the first idle
  */
-Eina_List *data_update_album_list(void)
+static Eina_Bool _verify_album_cache_cb(void *data)
 {
-	Eina_List *album_list = NULL;
+	album_stamp_s stamp = { 0, };
 
-	data_destroy_album_list();
-	album_list = data_create_album_list();
+	s_info.cache_idler = NULL;
+
+	if (!_read_db_stamp(&stamp) || stamp.media_count != s_info.cache_stamp.media_count || stamp.modified != s_info.cache_stamp.modified) {
+		LOGGER_I(LOG_TAG, "album cache is stale, rebuilding");
+		data_update_album_list();
+	} else {
+		_watch_media_db(true);
+	}
 
-	return album_list;
+	return ECORE_CALLBACK_CANCEL;
 }
 
 /*
- * @brief: Destroys media info
+ * @brief: Fills the album list, from the cache file when there is one
+ * A cached list is usable at once; the media DB is only checked later
+ * from an idler and the list rebuilt if the DB moved on.
+ * Returns the number of albums, or -1 on failure
  */
-static void _destroy_media_info(void)
+int data_create_album_list(void)
 {
-	if (s_info.media_info == NULL) {
-		return;
+	const char *cache_path = _get_album_cache_path();
+
+	if (s_info.filter == NULL) {
+		_create_media_filter();
 	}
 
-	if (media_info_destroy(s_info.media_info) != MEDIA_CONTENT_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "failed to destroy media info");
+	if (cache_path && album_store_load(cache_path, &s_info.cache_stamp)) {
+		s_info.cache_stamp_known = true;
+		s_info.cache_dirty = false;
+		LOGGER_I(LOG_TAG, "%d albums from the cache", album_store_count());
+		if (s_info.cache_idler == NULL) {
+			s_info.cache_idler = ecore_idler_add(_verify_album_cache_cb, NULL);
+		}
+		return album_store_count();
 	}
-	s_info.media_info = NULL;
+
+	return _enumerate_albums();
 }
 
 /*
- * @brief: Destroys a media filter handle
+ * @brief: Rebuild album list data from the media DB
+ * Only needed as a fallback, changes are applied as they are notified.
+ */
+int data_update_album_list(void)
+{
+	album_store_clear();
+	/* An empty store must not be saved over the cache if the rebuild fails */
+	s_info.cache_stamp_known = false;
+
+	return _enumerate_albums();
+}
+
+/*
+ * @brief: Destroys the media filter handles
  */
 static void _destroy_media_filter(void)
 {
-	if (s_info.filter == NULL) {
-		return;
+	if (s_info.filter && media_filter_destroy(s_info.filter) != MEDIA_CONTENT_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to destroy filter");
 	}
+	s_info.filter = NULL;
 
-	if (media_filter_destroy(s_info.filter) != MEDIA_CONTENT_ERROR_NONE) {
+	if (s_info.media_filter && media_filter_destroy(s_info.media_filter) != MEDIA_CONTENT_ERROR_NONE) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "failed to destroy filter");
 	}
-	s_info.filter = NULL;
+	s_info.media_filter = NULL;
 }
 
 /*
- * @brief: Creates a media filter handle and set condition & order
+ * @brief: Creates a music filter handle ordered by one column
+ * @param[order_type]: Ascending or descending
+ * @param[order_keyword]: Column to sort by
  */
-static void _create_media_filter(void)
+static filter_h _create_filter(media_content_order_e order_type, const char *order_keyword)
 {
 	char *condition = "MEDIA_TYPE=3"; //0: image, 1: video, 2: sound, 3: music, 4: other
+	filter_h filter = NULL;
 	int ret = MEDIA_CONTENT_ERROR_NONE;
 
-	ret = media_filter_create(&s_info.filter);
+	ret = media_filter_create(&filter);
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		s_info.filter = NULL;
-		return;
+		return NULL;
 	}
 
-	ret = media_filter_set_condition(s_info.filter, condition, MEDIA_CONTENT_COLLATE_DEFAULT);
+	ret = media_filter_set_condition(filter, condition, MEDIA_CONTENT_COLLATE_DEFAULT);
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		_destroy_media_filter();
-		return;
+		media_filter_destroy(filter);
+		return NULL;
 	}
 
-	ret = media_filter_set_order(s_info.filter, MEDIA_CONTENT_ORDER_ASC, MEDIA_TITLE, MEDIA_CONTENT_COLLATE_NOCASE);
+	ret = media_filter_set_order(filter, order_type, order_keyword, MEDIA_CONTENT_COLLATE_NOCASE);
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
+		media_filter_destroy(filter);
+		return NULL;
+	}
+
+	return filter;
+}
+
+/*
+ * @brief: Creates the album filter and the music filter, rows come grouped by album
+ */
+static void _create_media_filter(void)
+{
+	s_info.filter = _create_filter(MEDIA_CONTENT_ORDER_ASC, MEDIA_TITLE);
+	s_info.media_filter = _create_filter(MEDIA_CONTENT_ORDER_ASC, MEDIA_ALBUM);
+	if (s_info.filter == NULL || s_info.media_filter == NULL) {
 		_destroy_media_filter();
+	}
+}
+
+/*
+ * @brief: Keeps a music item if it is its album's pick
+ * @param[media]: The structure type for the Media info handle, only valid during the call
+ * @param[album_data]: Album being filled
+ * The pick is the item with the last title, as the old per album query
+ * ordered by title returned. Nothing is cloned; strings are only taken
+ * for a new pick.
+ */
+static void _pick_media(media_info_h media, album_data_s *album_data)
+{
+	char *title = NULL;
+	char *path = NULL;
+
+	if (media_info_get_title(media, &title) != MEDIA_CONTENT_ERROR_NONE || title == NULL) {
+		free(title);
+		title = NULL;
+		if (media_info_get_display_name(media, &title) != MEDIA_CONTENT_ERROR_NONE) {
+			return;
+		}
+	}
+
+	if (album_data->title && title && strcasecmp(title, album_data->title) < 0) {
+		free(title);
+		return;
+	}
+
+	if (media_info_get_file_path(media, &path) != MEDIA_CONTENT_ERROR_NONE) {
+		free(title);
 		return;
 	}
+
+	free(album_data->title);
+	free(album_data->file_path);
+	album_data->title = title;
+	album_data->file_path = path;
 }
 
 /*
- * @brief: Iterates through the media files with an optional filter from the media database
+ * @brief: Reads one music item of the full enumeration
  * @param[media]: The structure type for the Media info handle
- * @param[user_data]: Data needed in this function
+ * @param[user_data]: Album scan
  */
 static bool _media_item_cb(media_info_h media, void *user_data)
 {
-	album_data_s *album_data = user_data;
-	char *title = NULL;
-	char *path = NULL;
+	album_scan_s *scan = user_data;
+	audio_meta_h audio = NULL;
+	char *album = NULL;
+	intptr_t index = 0;
+
+	if (media_info_get_audio(media, &audio) != MEDIA_CONTENT_ERROR_NONE) {
+		return true;
+	}
+
+	audio_meta_get_album(audio, &album);
+	audio_meta_destroy(audio);
+	if (album == NULL) {
+		return true;
+	}
+
+	index = (intptr_t)eina_hash_find(scan->by_name, album);
+	free(album);
+	/* A shared name leaves its albums to their own queries */
+	if (index > 0) {
+		_pick_media(media, &scan->albums[index - 1]);
+	}
+
+	return true;
+}
+
+/*
+ * @brief: Reads one music item of a single album
+ * @param[media]: The structure type for the Media info handle
+ * @param[user_data]: Album being refreshed
+ */
+static bool _album_media_cb(media_info_h media, void *user_data)
+{
+	_pick_media(media, user_data);
+
+	return true;
+}
+
+/*
+ * @brief: Iterates through the media album with optional filter from the media database
+ * @param[album]: The structure type for the Media album handle
+ * @param[user_data]: Album scan
+ */
+static bool _album_list_cb(media_album_h album, void *user_data)
+{
+	album_scan_s *scan = user_data;
+	album_data_s *album_data = NULL;
+	char *name = NULL;
+	intptr_t index = 0;
 	int ret = MEDIA_CONTENT_ERROR_NONE;
-	media_content_type_e media_type = 0;
 
-	ret = media_info_clone(&s_info.media_info, media);
-	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "failed to clone media info");
+	if (album == NULL) {
 		return false;
 	}
 
-	ret = media_info_get_media_type(media, &media_type);
+	if (scan->count == scan->size) {
+		int size = scan->size ? scan->size * 2 : ALBUM_STORE_MIN_ENTRIES;
+		album_data_s *albums = realloc(scan->albums, size * sizeof(*albums));
+
+		if (albums == NULL) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "failed to grow the album scan");
+			return false;
+		}
+		scan->albums = albums;
+		scan->size = size;
+	}
+
+	album_data = &scan->albums[scan->count];
+	memset(album_data, 0, sizeof(*album_data));
+
+	ret = media_album_get_album_id(album, &album_data->album_id);
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		media_info_destroy(s_info.media_info);
-		s_info.media_info = NULL;
 		return false;
 	}
 
-	if (media_type != MEDIA_CONTENT_TYPE_MUSIC) {
-		dlog_print(DLOG_ERROR, LOG_TAG, "media type is not music");
-		media_info_destroy(s_info.media_info);
-		s_info.media_info = NULL;
+	ret = media_album_get_artist(album, &album_data->artist);
+	if (ret != MEDIA_CONTENT_ERROR_NONE) {
 		return false;
 	}
 
-	ret = media_info_get_file_path(media, &path);
+	ret = media_album_get_album_art(album, &album_data->album_art);
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		media_info_destroy(s_info.media_info);
-		s_info.media_info = NULL;
+		_free_album_data(album_data);
 		return false;
 	}
 
+	scan->count++;
 
-	ret = media_info_get_title(media, &title);
-	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		media_info_destroy(s_info.media_info);
-		s_info.media_info = NULL;
-		free(path);
-		return false;
+	/* Albums sharing a name are told apart by nothing in a media row */
+	if (media_album_get_name(album, &name) != MEDIA_CONTENT_ERROR_NONE || name == NULL) {
+		album_data->own_query = true;
+		return true;
 	}
 
-	if (title == NULL) {
-		ret = media_info_get_display_name(media, &title);
-		if (ret != MEDIA_CONTENT_ERROR_NONE) {
-			media_info_destroy(s_info.media_info);
-			s_info.media_info = NULL;
-			free(path);
-			return false;
+	index = (intptr_t)eina_hash_find(scan->by_name, name);
+	if (index == 0) {
+		eina_hash_add(scan->by_name, name, (void *)(intptr_t)scan->count);
+	} else {
+		if (index > 0) {
+			scan->albums[index - 1].own_query = true;
+			eina_hash_modify(scan->by_name, name, (void *)(intptr_t)SCAN_SHARED_NAME);
 		}
+		album_data->own_query = true;
+	}
+	free(name);
+
+	return true;
+}
+
+/*
+ * @brief: Re-reads one album and applies the result to the album store
+ * @param[album_data]: Album id, artist and album art, released here
+ * The stored entry is replaced when the pick changed and removed when the
+ * album has no music left.
+ */
+static void _refresh_album(album_data_s *album_data)
+{
+	album_info_s info;
+	int index = 0;
+	int ret = MEDIA_CONTENT_ERROR_NONE;
+
+	ret = media_album_foreach_media_from_db(album_data->album_id, s_info.filter, _album_media_cb, album_data);
+	if (ret != MEDIA_CONTENT_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] album %d query error: %d", __FILE__, __LINE__, album_data->album_id, ret);
+		_free_album_data(album_data);
+		return;
+	}
+
+	index = album_store_find_album(album_data->album_id);
+	if (index >= 0 && album_store_get(index, &info)
+			&& (album_data->file_path == NULL || strcmp(info.file_path, album_data->file_path))) {
+		LOGGER_D(LOG_TAG, "remove album data : %s", info.file_path);
+		album_store_remove(info.file_path);
+	}
+
+	s_info.cache_dirty = true;
+	if (album_data->file_path) {
+		LOGGER_D(LOG_TAG, "[%d] %s - %s (%s, %s)", album_data->album_id, album_data->title, album_data->artist, album_data->album_art, album_data->file_path);
+		album_store_add(album_data->album_id, album_data->title, album_data->artist, album_data->album_art, album_data->file_path);
 	}
 
-	album_data->file_path = path ? path : strdup("NULL");
-	album_data->title = title ? title : strdup("NULL");
+	_free_album_data(album_data);
+}
 
-	media_info_destroy(s_info.media_info);
-	s_info.media_info = NULL;
+/*
+ * @brief: Refreshes the stored album at a list index
+ * @param[index]: Index in album list
+ */
+static void _refresh_stored_album(int index)
+{
+	album_data_s album_data = { 0, };
+	album_info_s info;
+
+	if (!album_store_get(index, &info)) {
+		return;
+	}
+
+	/* Copied, the store strings may move while the album is applied */
+	album_data.album_id = info.album_id;
+	album_data.artist = strdup(info.artist);
+	album_data.album_art = strdup(info.album_art);
+	_refresh_album(&album_data);
+}
+
+static bool _changed_album_cb(media_album_h album, void *user_data)
+{
+	album_data_s album_data = { 0, };
+
+	if (media_album_get_album_id(album, &album_data.album_id) != MEDIA_CONTENT_ERROR_NONE) {
+		return true;
+	}
+
+	media_album_get_artist(album, &album_data.artist);
+	media_album_get_album_art(album, &album_data.album_art);
+	_refresh_album(&album_data);
 
 	return true;
 }
 
 /*
- * @brief: Iterates through the media album with optional filter from the media database
- * @param[album]: The structure type for the Media album handle
- * @param[user_data]: Data needed in this function
+ * @brief: Refreshes the albums a media item belongs to
+ * @param[media_id]: Media DB id of the item
+ * Returns false if the item or its albums could not be read
  */
-static bool _album_list_cb(media_album_h album, void *user_data)
+static bool _refresh_albums_of(const char *media_id)
 {
-	album_data_s *album_data = NULL;
-	int album_id = 0;
+	char condition[DATA_ALBUM_CONDITION_MAX] = { 0, };
+	media_info_h media = NULL;
+	audio_meta_h audio = NULL;
+	filter_h filter = NULL;
+	char *album = NULL;
+	bool truncated = false;
+	int len = 0;
 	int ret = MEDIA_CONTENT_ERROR_NONE;
-	char *artist = NULL;
-	char *album_art = NULL;
+	int i;
 
-	if (album == NULL) {
+	if (media_id == NULL || media_info_get_media_from_db(media_id, &media) != MEDIA_CONTENT_ERROR_NONE) {
 		return false;
 	}
 
-	if (s_info.filter == NULL) {
+	ret = media_info_get_audio(media, &audio);
+	media_info_destroy(media);
+	if (ret != MEDIA_CONTENT_ERROR_NONE) {
 		return false;
 	}
 
-	album_data = malloc(sizeof(*album_data));
+	audio_meta_get_album(audio, &album);
+	audio_meta_destroy(audio);
+	if (album == NULL) {
+		return false;
+	}
 
-	ret = media_album_get_album_id(album, &album_id);
-	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		_destroy_media_filter();
-		free(album_data);
+	/* Quotes in the name are doubled for the SQL condition */
+	len = snprintf(condition, sizeof(condition), "MEDIA_TYPE=3 AND MEDIA_ALBUM='");
+	for (i = 0; album[i] && len < (int)sizeof(condition) - 3; i++) {
+		if (album[i] == '\'') {
+			condition[len++] = '\'';
+		}
+		condition[len++] = album[i];
+	}
+	truncated = album[i] != '\0';
+	condition[len++] = '\'';
+	condition[len] = '\0';
+	free(album);
+	if (truncated) {
 		return false;
 	}
 
-	ret = media_album_get_artist(album, &artist);
-	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		_destroy_media_filter();
-		free(album_data);
+	if (media_filter_create(&filter) != MEDIA_CONTENT_ERROR_NONE) {
 		return false;
 	}
 
-	ret = media_album_get_album_art(album, &album_art);
+	ret = media_filter_set_condition(filter, condition, MEDIA_CONTENT_COLLATE_DEFAULT);
+	if (ret == MEDIA_CONTENT_ERROR_NONE) {
+		ret = media_album_foreach_album_from_db(filter, _changed_album_cb, NULL);
+	}
+	media_filter_destroy(filter);
+
+	return ret == MEDIA_CONTENT_ERROR_NONE;
+}
+
+/*
+ * @brief: Applies a media DB change to the album store
+ * Music file changes only touch the albums involved; anything else, or a
+ * change that cannot be resolved, rebuilds the whole list.
+ */
+static void _db_updated_cb(media_content_error_e error, int pid, media_content_db_update_item_type_e update_item,
+		media_content_db_update_type_e update_type, media_content_type_e media_type,
+		char *uuid, char *path, char *mime_type, void *user_data)
+{
+	int index = 0;
+
+	if (error != MEDIA_CONTENT_ERROR_NONE || s_info.filter == NULL) {
+		return;
+	}
+
+	if (update_item != MEDIA_ITEM_FILE || path == NULL) {
+		LOGGER_I(LOG_TAG, "media DB changed, rebuilding the album list");
+		data_update_album_list();
+		return;
+	}
+
+	/* Read before the change is applied, like a full enumeration does */
+	s_info.cache_stamp_known = _read_db_stamp(&s_info.cache_stamp);
+
+	/* The album the item was the pick of, if any */
+	index = album_store_find(path);
+	if (index >= 0 && update_type != MEDIA_CONTENT_INSERT) {
+		_refresh_stored_album(index);
+	}
+
+	if (update_type == MEDIA_CONTENT_DELETE || media_type != MEDIA_CONTENT_TYPE_MUSIC) {
+		return;
+	}
+
+	if (!_refresh_albums_of(uuid)) {
+		LOGGER_I(LOG_TAG, "could not apply the change of %s, rebuilding the album list", path);
+		data_update_album_list();
+	}
+}
+
+/*
+ * @brief: Start or stop following media DB changes
+ */
+static void _watch_media_db(bool watch)
+{
+	int ret = MEDIA_CONTENT_ERROR_NONE;
+
+	if (watch == s_info.watching) {
+		return;
+	}
+
+	if (watch) {
+		ret = media_content_set_db_updated_cb(_db_updated_cb, NULL);
+	} else {
+		ret = media_content_unset_db_updated_cb();
+	}
+
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		_destroy_media_filter();
-		free(artist);
-		free(album_data);
+		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] media DB notification error: %d", __FILE__, __LINE__, ret);
+		return;
+	}
+
+	s_info.watching = watch;
+}
+
+static const char *_get_album_cache_path(void)
+{
+	char *data_path = NULL;
+
+	if (s_info.cache_path) {
+		return s_info.cache_path;
+	}
+
+	data_path = app_get_data_path();
+	if (data_path == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to get the data path.");
+		return NULL;
+	}
+
+	s_info.cache_path = malloc(strlen(data_path) + sizeof(DATA_ALBUM_CACHE));
+	if (s_info.cache_path) {
+		sprintf(s_info.cache_path, "%s%s", data_path, DATA_ALBUM_CACHE);
+	}
+	free(data_path);
+
+	return s_info.cache_path;
+}
+
+static bool _newest_media_cb(media_info_h media, void *user_data)
+{
+	time_t modified = 0;
+
+	if (media_info_get_modified_time(media, &modified) == MEDIA_CONTENT_ERROR_NONE) {
+		*(long long *)user_data = modified;
+	}
+
+	return false;
+}
+
+/*
+ * @brief: Reads the music count and newest modification time of the media DB
+ * Two small queries, the second only fetches one row.
+ */
+static bool _read_db_stamp(album_stamp_s *stamp)
+{
+	filter_h filter = NULL;
+	int count = 0;
+	int ret = MEDIA_CONTENT_ERROR_NONE;
+
+	if (s_info.filter == NULL) {
 		return false;
 	}
 
-	ret = media_album_foreach_media_from_db(album_id, s_info.filter, _media_item_cb, album_data);
+	ret = media_info_get_media_count_from_db(s_info.filter, &count);
 	if (ret != MEDIA_CONTENT_ERROR_NONE) {
-		_destroy_media_filter();
-		free(artist);
-		free(album_art);
-		free(album_data);
 		return false;
 	}
 
-	album_data->album_id = album_id;
-	album_data->artist = artist ? artist : strdup("NULL");
-	album_data->album_art = album_art ? album_art : strdup("NULL");
+	filter = _create_filter(MEDIA_CONTENT_ORDER_DESC, MEDIA_MODIFIED_TIME);
+	if (filter == NULL) {
+		return false;
+	}
 
-	dlog_print(DLOG_DEBUG, LOG_TAG, "[%d] %s - %s (%s, %s)", album_data->album_id, album_data->title, album_data->artist, album_data->album_art, album_data->file_path);
+	ret = media_filter_set_offset(filter, 0, 1);
 
-	/*
-	 * append album data to album list
-	 */
-	s_info.list = eina_list_append(s_info.list, album_data);
+	stamp->media_count = count;
+	stamp->modified = 0;
+	if (ret == MEDIA_CONTENT_ERROR_NONE) {
+		ret = media_info_foreach_media_from_db(filter, _newest_media_cb, &stamp->modified);
+	}
+	media_filter_destroy(filter);
 
-	return true;
+	return ret == MEDIA_CONTENT_ERROR_NONE;
+}
+
+/*
+ * @brief: Writes the album list to the cache with the stamp read before it was built
+ * Never queries the media DB; without a known stamp nothing is written and
+ * the next start enumerates.
+ */
+static void _save_album_cache(void)
+{
+	const char *cache_path = _get_album_cache_path();
+
+	if (cache_path == NULL || !s_info.cache_stamp_known) {
+		return;
+	}
+
+	if (album_store_save(cache_path, &s_info.cache_stamp)) {
+		s_info.cache_dirty = false;
+	}
 }
 
 /*
  * @brief: Remove a album data in album list
  * @param[file_path]: File path of music
+ * Returns the number of albums left
  */
-Eina_List *data_remove_album_data_by_file_path(const char *file_path)
+int data_remove_album_data_by_file_path(const char *file_path)
 {
-	Eina_List *l = NULL;
-	Eina_List *n = NULL;
-	album_data_s *album_data = NULL;
+	if (album_store_remove(file_path)) {
+		LOGGER_D(LOG_TAG, "remove album data : %s", file_path);
+	}
+
+	return album_store_count();
+}
 
-	EINA_LIST_FOREACH_SAFE(s_info.list, l, n, album_data) {
-		if (!strcmp(album_data->file_path, file_path)) {
-			dlog_print(DLOG_DEBUG, LOG_TAG, "remove album data : %s - %s(%s)", album_data->title, album_data->artist, album_data->file_path);
-			s_info.list = eina_list_remove(s_info.list, album_data);
+/*
+ * @brief: Drop the album list under memory pressure, returns the bytes released
+ * Pending changes go to the cache first when their DB stamp is known, so
+ * data_create_album_list() brings the list back without a full
+ * enumeration. No media DB query runs here.
+ */
+size_t data_trim_album_list(void)
+{
+	size_t before = album_store_memory();
 
-			free(album_data->album_art);
-			free(album_data->artist);
-			free(album_data->file_path);
-			free(album_data->title);
-			free(album_data);
+	data_destroy_album_list();
 
-			break;
-		}
-	}
+	return before - album_store_memory();
+}
 
-	return s_info.list;
+/*
+ * @brief: Bytes held by the album list
+ */
+size_t data_album_memory(void)
+{
+	return album_store_memory();
 }
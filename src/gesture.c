@@ -0,0 +1,382 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <math.h>
+#include <string.h>
+#include "hellomex.h"
+#include "gesture.h"
+#include "logger.h"
+#include "stream.h"
+
+/*
+ * Everything below runs once per fed sample with fixed size state, so the
+ * cost per sample does not depend on how long the stream has been running.
+ */
+
+/* The engine runs at most at 50 Hz, templates are sampled at that rate */
+#define FEED_INTERVAL 20000ULL
+/* Low pass weight separating gravity from linear acceleration */
+#define GRAVITY_ALPHA 0.1f
+/* No new gesture this long after the previous one, in us */
+#define REFRACTORY 400000ULL
+
+/* Shake: direction reversals of strong linear acceleration within a window */
+#define SHAKE_THRESHOLD 12.0f
+#define SHAKE_REVERSALS 4
+#define SHAKE_WINDOW 800000ULL
+
+/* Tilt: gravity leaving the z axis, sin(35) to enter and sin(20) to re-arm */
+#define TILT_ENTER 0.57f
+#define TILT_EXIT 0.34f
+#define TILT_HOLD 300000ULL
+
+/* Swing: subsequence DTW of the linear x acceleration against a template */
+#define DTW_LEN 10
+#define DTW_THRESHOLD 3.0f
+#define DTW_INF 1e9f
+
+/* Swing right at 50 Hz in m/s^2, push then brake. Swing left is mirrored */
+static const float swing_template[DTW_LEN] = {
+	2.0f, 6.0f, 11.0f, 15.0f, 13.0f, 6.0f, -3.0f, -9.0f, -7.0f, -2.0f,
+};
+
+typedef struct _dtw_state {
+	float sign;
+	float column[DTW_LEN];
+} dtw_state_s;
+
+static struct _s_info {
+	unsigned int enabled;
+	unsigned long long last_feed;
+	unsigned long long quiet_until;
+	float gravity[3];
+	bool gravity_ready;
+	/* shake */
+	bool shake_peak;
+	float shake_dir[3];
+	unsigned int shake_reversals;
+	unsigned long long shake_start;
+	/* tilt */
+	gesture_type_e tilt;
+	gesture_type_e tilt_candidate;
+	unsigned long long tilt_since;
+	/* swing */
+	dtw_state_s swing[2];
+} s_info = {
+	.enabled = 0,
+};
+
+static void _dtw_reset(dtw_state_s *dtw)
+{
+	int i;
+
+	for (i = 0; i < DTW_LEN; i++)
+		dtw->column[i] = DTW_INF;
+}
+
+/*
+ * One DTW column per sample. A path may start at any sample, which is what
+ * makes this a sliding window search without keeping the window itself.
+ * Returns the mean cost per template point of the best match ending now.
+ */
+static float _dtw_step(dtw_state_s *dtw, float x)
+{
+	float diag = 0.0f;
+	float left = 0.0f;
+	int i;
+
+	for (i = 0; i < DTW_LEN; i++) {
+		float up = dtw->column[i];
+		float best = up < left ? up : left;
+		float cost = fabsf(x - dtw->sign * swing_template[i]);
+
+		if (diag < best)
+			best = diag;
+
+		diag = up;
+		left = cost + best;
+		dtw->column[i] = left;
+	}
+
+	return dtw->column[DTW_LEN - 1] / DTW_LEN;
+}
+
+static unsigned int _strength(float value, float threshold, float full)
+{
+	float s = (value - threshold) / (full - threshold) * 255.0f;
+
+	if (s < 0.0f)
+		return 0;
+	if (s > 255.0f)
+		return 255;
+	return (unsigned int)s;
+}
+
+/*
+ * While quiet a complete shake is not reported and the reversal count is
+ * kept, so the next reversal after the refractory window reports it.
+ */
+static bool _detect_shake(unsigned long long ts, const float *lin, bool quiet, gesture_event_s *event_out)
+{
+	float mag = sqrtf(lin[0] * lin[0] + lin[1] * lin[1] + lin[2] * lin[2]);
+	float dot = 0.0f;
+
+	if (mag < SHAKE_THRESHOLD / 2.0f) {
+		s_info.shake_peak = false;
+		return false;
+	}
+
+	if (mag < SHAKE_THRESHOLD)
+		return false;
+
+	dot = lin[0] * s_info.shake_dir[0] + lin[1] * s_info.shake_dir[1] + lin[2] * s_info.shake_dir[2];
+
+	/* A new peak, or the same peak flipping straight to the other side */
+	if (!s_info.shake_peak || dot < 0.0f) {
+		s_info.shake_peak = true;
+
+		if (s_info.shake_reversals == 0 || ts - s_info.shake_start > SHAKE_WINDOW) {
+			s_info.shake_reversals = 1;
+			s_info.shake_start = ts;
+		} else if (dot < 0.0f) {
+			s_info.shake_reversals++;
+		}
+
+		s_info.shake_dir[0] = lin[0] / mag;
+		s_info.shake_dir[1] = lin[1] / mag;
+		s_info.shake_dir[2] = lin[2] / mag;
+
+		if (s_info.shake_reversals >= SHAKE_REVERSALS && !quiet) {
+			s_info.shake_reversals = 0;
+			event_out->type = GESTURE_SHAKE;
+			event_out->strength = _strength(mag, SHAKE_THRESHOLD, 3.0f * SHAKE_THRESHOLD);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Accelerometer axes read +g on the axis pointing up, so the side that
+ * goes down reads negative. While quiet a held tilt is not latched, it is
+ * reported on the first sample after the refractory window.
+ */
+static bool _detect_tilt(unsigned long long ts, bool quiet, gesture_event_s *event_out)
+{
+	const float *g = s_info.gravity;
+	float norm = sqrtf(g[0] * g[0] + g[1] * g[1] + g[2] * g[2]);
+	gesture_type_e candidate = GESTURE_NONE;
+	float nx = 0.0f;
+	float ny = 0.0f;
+	float lean = 0.0f;
+
+	if (norm < 1.0f)
+		return false;
+
+	nx = g[0] / norm;
+	ny = g[1] / norm;
+
+	if (s_info.tilt != GESTURE_NONE) {
+		if (fabsf(nx) < TILT_EXIT && fabsf(ny) < TILT_EXIT)
+			s_info.tilt = GESTURE_NONE;
+		return false;
+	}
+
+	if (fabsf(nx) >= fabsf(ny) && fabsf(nx) > TILT_ENTER) {
+		candidate = nx < 0.0f ? GESTURE_TILT_RIGHT : GESTURE_TILT_LEFT;
+		lean = fabsf(nx);
+	} else if (fabsf(ny) > TILT_ENTER) {
+		candidate = ny < 0.0f ? GESTURE_TILT_FORWARD : GESTURE_TILT_BACK;
+		lean = fabsf(ny);
+	}
+
+	if (candidate != s_info.tilt_candidate) {
+		s_info.tilt_candidate = candidate;
+		s_info.tilt_since = ts;
+		return false;
+	}
+
+	if (candidate == GESTURE_NONE || ts - s_info.tilt_since < TILT_HOLD || quiet)
+		return false;
+
+	if (!(s_info.enabled & GESTURE_BIT(candidate)))
+		return false;
+
+	s_info.tilt = candidate;
+	event_out->type = candidate;
+	event_out->strength = _strength(lean, TILT_ENTER, 1.0f);
+	return true;
+}
+
+/*
+ * Both directions step on every sample before one is picked, a match on
+ * one side must not leave the other column behind the signal
+ */
+static bool _detect_swing(const float *lin, gesture_event_s *event_out)
+{
+	float best = DTW_THRESHOLD;
+	bool found = false;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		gesture_type_e type = s_info.swing[i].sign > 0.0f ? GESTURE_SWING_RIGHT : GESTURE_SWING_LEFT;
+		float score = _dtw_step(&s_info.swing[i], lin[0]);
+
+		if (!(s_info.enabled & GESTURE_BIT(type)) || score > best)
+			continue;
+
+		best = score;
+		found = true;
+		event_out->type = type;
+		event_out->strength = _strength(DTW_THRESHOLD - score, 0.0f, DTW_THRESHOLD);
+	}
+
+	return found;
+}
+
+/*
+ * @brief: Initialization function for gesture module
+ */
+void gesture_initialize(void)
+{
+	memset(&s_info, 0, sizeof(s_info));
+	s_info.swing[0].sign = 1.0f;
+	s_info.swing[1].sign = -1.0f;
+	_dtw_reset(&s_info.swing[0]);
+	_dtw_reset(&s_info.swing[1]);
+}
+
+/*
+ * @brief: Select the gestures to recognise
+ * @param[gestures]: Bitmask of GESTURE_BIT(), 0 turns the engine off
+ */
+void gesture_set_enabled(unsigned int gestures)
+{
+	unsigned int enabled = gestures & GESTURE_ALL;
+
+	if (enabled && !s_info.enabled)
+		gesture_initialize();
+
+	s_info.enabled = enabled;
+	LOGGER_I(LOG_TAG, "gestures 0x%x", enabled);
+}
+
+/*
+ * @brief: Get the gestures being recognised
+ */
+unsigned int gesture_get_enabled(void)
+{
+	return s_info.enabled;
+}
+
+/*
+ * @brief: Handle a PROTO_MSG_GESTURES message
+ * @param[body]: Body of the message
+ */
+void gesture_handle_message(const proto_view_s *body)
+{
+	unsigned int gestures = 0;
+	unsigned int divider = 1;
+
+	if (!proto_get_u8(body, 0, &gestures)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "short gestures message (%u)", body->length);
+		return;
+	}
+	proto_get_u8(body, 1, &divider);
+
+	gesture_set_enabled(gestures);
+	stream_set_decimation(gesture_get_enabled() ? divider : 1);
+}
+
+/*
+ * @brief: Feed one accelerometer sample
+ * @param[timestamp]: Sensor timestamp in microseconds
+ * @param[accel]: x, y and z in m/s^2
+ * @param[event_out]: Recognised gesture, only set when true is returned
+ */
+bool gesture_feed(unsigned long long timestamp, const float *accel, gesture_event_s *event_out)
+{
+	gesture_event_s found[3];
+	float lin[3];
+	bool shake = false;
+	bool swing = false;
+	bool tilt = false;
+	bool quiet = false;
+	int i;
+
+	if (!s_info.enabled || timestamp - s_info.last_feed < FEED_INTERVAL) {
+		return false;
+	}
+	s_info.last_feed = timestamp;
+	quiet = timestamp < s_info.quiet_until;
+
+	if (!s_info.gravity_ready) {
+		memcpy(s_info.gravity, accel, sizeof(s_info.gravity));
+		s_info.gravity_ready = true;
+	}
+
+	for (i = 0; i < 3; i++) {
+		s_info.gravity[i] += GRAVITY_ALPHA * (accel[i] - s_info.gravity[i]);
+		lin[i] = accel[i] - s_info.gravity[i];
+	}
+
+	/*
+	 * Detectors always advance so their state stays continuous, but none
+	 * consumes a detection during the refractory window
+	 */
+	if (s_info.enabled & GESTURE_BIT(GESTURE_SHAKE))
+		shake = _detect_shake(timestamp, lin, quiet, &found[0]);
+	swing = _detect_swing(lin, &found[1]);
+	tilt = _detect_tilt(timestamp, quiet, &found[2]);
+
+	if (!(shake || swing || tilt) || quiet) {
+		return false;
+	}
+
+	/* A shake contains swings, report the most specific gesture */
+	*event_out = shake ? found[0] : swing ? found[1] : found[2];
+
+	s_info.quiet_until = timestamp + REFRACTORY;
+	_dtw_reset(&s_info.swing[0]);
+	_dtw_reset(&s_info.swing[1]);
+	event_out->timestamp = timestamp;
+
+	return true;
+}
+
+/*
+ * @brief: Encode a gesture as a PROTO_MSG_GESTURE message
+ * @param[event]: Recognised gesture
+ * @param[buf]: Output buffer
+ * @param[buf_size]: Size of the output buffer
+ * Returns the message length or 0 if the buffer is too small
+ */
+int gesture_build_message(const gesture_event_s *event, unsigned char *buf, int buf_size)
+{
+	unsigned char *body = buf + PROTO_HEADER_SIZE;
+
+	if (buf_size < PROTO_HEADER_SIZE + PROTO_GESTURE_SIZE) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_GESTURE, PROTO_GESTURE_SIZE);
+	body[0] = event->type;
+	body[1] = event->strength;
+	proto_put_u32(body + 2, (unsigned int)(event->timestamp / 1000));
+
+	return PROTO_HEADER_SIZE + PROTO_GESTURE_SIZE;
+}
@@ -17,6 +17,12 @@
 #include "hellomex.h"
 #include "view.h"
 #include "data.h"
+#include "logger.h"
+#include "pressure.h"
+#include "stats.h"
+#include "stream.h"
+#include "thumb.h"
+#include "toast.h"
 
 #define PUSHTAG = "PUSH"
 
@@ -30,169 +36,288 @@ typedef struct appdata {
 
 static appdata_s *object;
 
-static void _timeout_cb(void *data, Evas_Object *obj, void *event_info)
+void update_ui(char *data)
 {
-	if (!obj) return;
-	elm_popup_dismiss(obj);
+	LOGGER_I(TAG, "Updating UI with data %s", data);
+	toast_show(data);
 }
 
-static void _block_clicked_cb(void *data, Evas_Object *obj, void *event_info)
+
+typedef struct _item_data {
+	int index;
+	Elm_Object_Item *item;
+} item_data;
+
+/*
+ * Controller only mode: while polls keep coming nobody looks at the
+ * screen, so the layout goes dark, edje animations stop and buttons give
+ * no visual feedback. Touches are still delivered as usual.
+ */
+static struct _render_info {
+	bool allowed;
+	bool controller_only;
+	double last_poll;
+	Ecore_Timer *idle_timer;
+} s_render = {
+	.allowed = true,
+	.controller_only = false,
+	.last_poll = 0.0,
+	.idle_timer = NULL,
+};
+
+/*
+ * In pointer mode the whole screen aims the cursor, touches over a button
+ * must not press it. The release always goes through, so a key held when
+ * the phone switched modes is still let go.
+ */
+static void _btn_down_cb(void *user_data, Evas *e, Evas_Object *obj, void *event_info)
 {
-	if (!obj) return;
-	elm_popup_dismiss(obj);
+	if (stream_get_config()->mode == STREAM_MODE_POINTER)
+		return;
+
+	keyPressed((int)(intptr_t)user_data);
+	if (!s_render.controller_only)
+		evas_object_color_set(obj, 250, 250, 250, 102);
 }
 
-static void _popup_hide_cb(void *data, Evas_Object *obj, void *event_info)
+static void _btn_up_cb(void *user_data, Evas *e, Evas_Object *obj, void *event_info)
 {
-	if (!obj) return;
-	elm_popup_dismiss(obj);
+	keyReleased((int)(intptr_t)user_data);
+	if (!s_render.controller_only)
+		evas_object_color_set(obj, 250, 250, 250, 255);
 }
-static void _popup_hide_finished_cb(void *data, Evas_Object *obj, void *event_info)
+
+static Eina_Bool _rotary_cb(void *user_data, Evas_Object *obj, Eext_Rotary_Event_Info *info)
 {
-	if (!obj) return;
-	evas_object_del(obj);
+	stream_push_wheel(info->direction == EEXT_ROTARY_DIRECTION_CLOCKWISE ? 1 : -1, info->time_stamp);
+	return EINA_TRUE;
 }
 
-static void _popup_toast_cb(Evas_Object *parent, char *string)
+static void _pointer_event(Evas_Object *obj, Evas_Coord ev_x, Evas_Coord ev_y, bool touching)
 {
-	Evas_Object *popup;
-
-
-	popup = elm_popup_add(parent);
-	elm_object_style_set(popup, "toast/circle");
-	elm_popup_orient_set(popup, ELM_POPUP_ORIENT_BOTTOM);
-	evas_object_size_hint_weight_set(popup, EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
-	eext_object_event_callback_add(popup, EEXT_CALLBACK_BACK, _popup_hide_cb, NULL);
-	evas_object_smart_callback_add(popup, "dismissed", _popup_hide_finished_cb, NULL);
-	elm_object_part_text_set(popup, "elm.text", string);
-
-	evas_object_smart_callback_add(popup, "block,clicked", _block_clicked_cb, NULL);
+	Evas_Coord x, y, w, h;
 
-	elm_popup_timeout_set(popup, 2.0);
+	if (stream_get_config()->mode != STREAM_MODE_POINTER)
+		return;
 
-	evas_object_smart_callback_add(popup, "timeout", _timeout_cb, NULL);
+	evas_object_geometry_get(obj, &x, &y, &w, &h);
+	if (w <= 0 || h <= 0)
+		return;
 
-	evas_object_show(popup);
+	stream_push_pointer((float)(ev_x - x) / w, (float)(ev_y - y) / h, touching);
 }
 
-void update_ui(char *data)
+static void _pointer_down_cb(void *user_data, Evas *e, Evas_Object *obj, void *event_info)
 {
-	dlog_print(DLOG_INFO, TAG, "Updating UI with data %s", data);
-	_popup_toast_cb(object->naviframe, data);
+	Evas_Event_Mouse_Down *ev = event_info;
+	_pointer_event(obj, ev->canvas.x, ev->canvas.y, true);
 }
 
+static void _pointer_move_cb(void *user_data, Evas *e, Evas_Object *obj, void *event_info)
+{
+	Evas_Event_Mouse_Move *ev = event_info;
+	_pointer_event(obj, ev->cur.canvas.x, ev->cur.canvas.y, true);
+}
 
-typedef struct _item_data {
-	int index;
-	Elm_Object_Item *item;
-} item_data;
+static void _pointer_up_cb(void *user_data, Evas *e, Evas_Object *obj, void *event_info)
+{
+	Evas_Event_Mouse_Up *ev = event_info;
+	_pointer_event(obj, ev->canvas.x, ev->canvas.y, false);
+}
 
-static void _btn_down_cb(void *user_data, Evas *e, Evas_Object *obj, void *event_info)
+static void _content_back_cb(void *user_data, Evas_Object *obj, void *event_info)
 {
-	evas_object_color_set(obj, 250, 250, 250, 102);
+	LOGGER_D(LOG_TAG, "exit application");
 }
 
-static void _btn_up_cb(void *data, Evas *e, Evas_Object *obj, void *event_info)
+static struct _startup_info {
+	double launched;
+	bool marked[2];
+	Evas_Object *content;
+	const char *edj_path;
+} s_startup = {
+	.launched = 0.0,
+	.content = NULL,
+	.edj_path = NULL,
+};
+
+/*
+ * @brief: Log how long a startup milestone took, only the first time it is reached
+ * @param[mark]: Milestone
+ */
+void startup_mark(startup_mark_e mark)
 {
-	//keyReleased();
-	dlog_print(DLOG_DEBUG, "PUSH", "RELEASED");
-	evas_object_color_set(obj, 250, 250, 250, 255);
+	static const char *names[] = { "first sample", "first frame" };
 
-}
+	if (mark < 0 || mark > STARTUP_FIRST_FRAME || s_startup.marked[mark])
+		return;
 
-static void _left_btn_clicked_cb(){ //void *user_data, Evas_Object *obj, void *event_info){
-	keyPressed(0);
-	dlog_print(DLOG_DEBUG, "PUSH", "LEFT ARROW CLICKED");
+	s_startup.marked[mark] = true;
+	LOGGER_I(LOG_TAG, "time to %s: %.1f ms", names[mark], (ecore_time_get() - s_startup.launched) * 1000.0);
 }
-static void _right_btn_clicked_cb(){ //(void *user_data, Evas_Object *obj, void *event_info){
-	keyPressed(1);
-	dlog_print(DLOG_DEBUG, "PUSH", "RIGHT ARROW CLICKED");
 
+static void _first_frame_cb(void *data, Evas *e, void *event_info)
+{
+	evas_event_callback_del(e, EVAS_CALLBACK_RENDER_POST, _first_frame_cb);
+	startup_mark(STARTUP_FIRST_FRAME);
 }
-static void _up_btn_clicked_cb(){ //(void *user_data, Evas_Object *obj, void *event_info){(void *user_data, Evas_Object *obj, void *event_info){
-	keyPressed(2);
-	dlog_print(DLOG_DEBUG, "PUSH", "UP ARROW CLICKED");
 
+static const char *controller_parts[] = {
+	[CONTROLLER_KEY_LEFT] = "left_arrow",
+	[CONTROLLER_KEY_RIGHT] = "right_arrow",
+	[CONTROLLER_KEY_UP] = "up_arrow",
+	[CONTROLLER_KEY_DOWN] = "down_arrow",
+	[CONTROLLER_KEY_A] = "a_btn",
+	[CONTROLLER_KEY_B] = "b_btn",
+};
+
+static void _controller_button(Evas_Object *content, const char *part_name, controller_key_e key)
+{
+	view_set_controller_button(content, part_name, s_startup.edj_path);
+	view_set_button_touch_callback(content, part_name, _btn_down_cb, _btn_up_cb, (void *)(intptr_t)key);
+	view_set_color(content, part_name, 250, 250, 250, 255);
 }
-static void _down_btn_clicked_cb(){ //(void *user_data, Evas_Object *obj, void *event_info){{ //(void *user_data, Evas_Object *obj, void *event_info){(void *user_data, Evas_Object *obj, void *event_info){
-	keyPressed(3);
-	dlog_print(DLOG_DEBUG, "PUSH", "DOWN ARROW CLICKED");
+
+/*
+ * Runs from the main loop after app_create returned, so the window and
+ * the SAP agent are up before the controller is built
+ */
+static void _build_controller_cb(void *data)
+{
+	Evas_Object *content = s_startup.content;
+	int i;
+
+	for (i = CONTROLLER_KEY_LEFT; i <= CONTROLLER_KEY_B; i++) {
+		_controller_button(content, controller_parts[i], i);
+	}
+
+	view_set_rotary_event_callback(content, _rotary_cb, NULL);
+
+	/* Moves over the buttons propagate to the layout as well */
+	evas_object_event_callback_add(content, EVAS_CALLBACK_MOUSE_DOWN, _pointer_down_cb, NULL);
+	evas_object_event_callback_add(content, EVAS_CALLBACK_MOUSE_MOVE, _pointer_move_cb, NULL);
+	evas_object_event_callback_add(content, EVAS_CALLBACK_MOUSE_UP, _pointer_up_cb, NULL);
 }
-static void _a_btn_clicked_cb(){ //(void *user_data, Evas_Object *obj, void *event_info){(void *user_data, Evas_Object *obj, void *event_info){
-	keyPressed(4);
-	dlog_print(DLOG_DEBUG, "PUSH", "A BTN CLICKED");
 
+static void _set_controller_only(bool on)
+{
+	Evas_Object *content = s_startup.content;
+	int i;
+
+	if (s_render.controller_only == on) {
+		return;
+	}
+
+	s_render.controller_only = on;
+	LOGGER_I(LOG_TAG, "controller only mode %s", on ? "on" : "off");
+
+	if (content == NULL) {
+		return;
+	}
+
+	/* A button held across the switch would otherwise keep its pressed colour */
+	for (i = CONTROLLER_KEY_LEFT; i <= CONTROLLER_KEY_B; i++) {
+		view_set_color(content, controller_parts[i], 250, 250, 250, 255);
+	}
+
+	if (on) {
+		elm_object_signal_emit(content, "render,minimal", "");
+		edje_object_play_set(elm_layout_edje_get(content), EINA_FALSE);
+	} else {
+		edje_object_play_set(elm_layout_edje_get(content), EINA_TRUE);
+		elm_object_signal_emit(content, "render,full", "");
+	}
 }
-static void _b_btn_clicked_cb(){ //(void *user_data, Evas_Object *obj, void *event_info){(void *user_data, Evas_Object *obj, void *event_info){
-	keyPressed(5);
-	dlog_print(DLOG_DEBUG, "PUSH", "B BTN CLICKED");
 
+static Eina_Bool _render_idle_timer_cb(void *data)
+{
+	if (ecore_time_get() - s_render.last_poll < CONTROLLER_ONLY_IDLE) {
+		return ECORE_CALLBACK_RENEW;
+	}
+
+	_set_controller_only(false);
+	s_render.idle_timer = NULL;
+
+	return ECORE_CALLBACK_CANCEL;
 }
 
-static void _content_back_cb(void *user_data, Evas_Object *obj, void *event_info)
+/*
+ * @brief: Note a poll from the phone, entering controller only mode
+ * The full UI comes back CONTROLLER_ONLY_IDLE seconds after the last poll.
+ */
+void render_streaming_active(void)
 {
-	dlog_print(DLOG_DEBUG, LOG_TAG, "exit application");
+	if (!s_render.allowed) {
+		return;
+	}
+
+	s_render.last_poll = ecore_time_get();
+	if (s_render.controller_only) {
+		return;
+	}
+
+	_set_controller_only(true);
+	if (s_render.idle_timer == NULL) {
+		s_render.idle_timer = ecore_timer_add(CONTROLLER_ONLY_IDLE, _render_idle_timer_cb, NULL);
+	}
 }
 
 static bool app_create(void *data)
 {
 
 	Evas_Object *conform = NULL;
-	Evas_Object *content = NULL;
-	char *icon_path = NULL;
-	char full_path[PATH_MAX] = { 0, };
+
+	s_startup.launched = ecore_time_get();
+	logger_initialize();
+
+	object = data;
+	/* The link and the sensors do not need any UI, start them first */
+	initialize_sap();
 
 	view_create(); // create window
-	data_get_resource_path(EDJ_FILE, full_path, sizeof(full_path)); // Load the EDJ
+	toast_initialize(object->naviframe ? object->naviframe : view_get_window());
+	evas_event_callback_add(evas_object_evas_get(view_get_window()), EVAS_CALLBACK_RENDER_POST, _first_frame_cb, NULL);
+	s_startup.edj_path = data_get_resource(DATA_RESOURCE_EDJ); // Load the EDJ
 
 	conform = view_get_conformant();
-	content = view_create_layout_for_conformant(conform, full_path, GRP_MAIN, _content_back_cb, NULL);
-	if (content == NULL) {
+	s_startup.content = view_create_layout_for_conformant(conform, s_startup.edj_path, GRP_MAIN, _content_back_cb, NULL);
+	if (s_startup.content == NULL) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "failed to create a content.");
 		return NULL;
 	}
 
-	icon_path = data_get_image("left_arrow");
-	view_set_button(content, "left_arrow", "focus", icon_path, NULL, _btn_down_cb, _btn_up_cb, _left_btn_clicked_cb, content);
-	view_set_color(content, "left_arrow", 250, 250, 250, 255);
-	free(icon_path);
-
-	icon_path = data_get_image("right_arrow");
-	view_set_button(content, "right_arrow", "focus", icon_path, NULL, _btn_down_cb, _btn_up_cb, _right_btn_clicked_cb, content);
-	view_set_color(content, "right_arrow", 250, 250, 250, 255);
-	free(icon_path);
-
-	icon_path = data_get_image("up_arrow");
-	view_set_button(content, "up_arrow", "focus", icon_path, NULL, _btn_down_cb, _btn_up_cb, _up_btn_clicked_cb, content);
-	view_set_color(content, "up_arrow", 250, 250, 250, 255);
-	free(icon_path);
+	/* Attached now, app_control may ask for the overlay before the job runs */
+	stats_overlay_attach(s_startup.content);
+	ecore_job_add(_build_controller_cb, NULL);
 
-	icon_path = data_get_image("down_arrow");
-	view_set_button(content, "down_arrow", "focus", icon_path, NULL, _btn_down_cb, _btn_up_cb, _down_btn_clicked_cb, content);
-	view_set_color(content, "down_arrow", 250, 250, 250, 255);
-	free(icon_path);
-
-	icon_path = data_get_image("a_btn");
-	view_set_button(content, "a_btn", "focus", icon_path, NULL, _btn_down_cb, _btn_up_cb, _a_btn_clicked_cb, content);
-	view_set_color(content, "a_btn", 250, 250, 250, 255);
-	free(icon_path);
-
-	icon_path = data_get_image("b_btn");
-	view_set_button(content, "b_btn", "focus", icon_path, NULL, _btn_down_cb, _btn_up_cb, _b_btn_clicked_cb, content);
-	view_set_color(content, "b_btn", 250, 250, 250, 255);
-	free(icon_path);
-
-	object = data;
 	//create_base_gui(object); //TODO: ADD GUI
-	initialize_sap();
-	keyReleased();
 	turn_on_screen();
 	return TRUE;
 }
 
 static void app_control(app_control_h app_control, void *data)
 {
+	char *value = NULL;
+
 	/* Handle the launch request. */
+	stream_set_config_from_app_control(app_control);
+
+	if (app_control_get_extra_data(app_control, "stats_overlay", &value) == APP_CONTROL_ERROR_NONE && value) {
+		stats_overlay_set_visible(!strcmp(value, "on"));
+		free(value);
+	}
+
+	if (app_control_get_extra_data(app_control, "memory_limit_kb", &value) == APP_CONTROL_ERROR_NONE && value) {
+		pressure_set_limit((size_t)strtoul(value, NULL, 10) * 1024);
+		free(value);
+	}
+
+	if (app_control_get_extra_data(app_control, "controller_only", &value) == APP_CONTROL_ERROR_NONE && value) {
+		s_render.allowed = strcmp(value, "off");
+		if (!s_render.allowed)
+			_set_controller_only(false);
+		free(value);
+	}
 }
 
 static void app_pause(void *data)
@@ -208,8 +333,18 @@ static void app_resume(void *data)
 static void app_terminate(void *data)
 {
 	/* Release all resources. */
+	if (s_render.idle_timer) {
+		ecore_timer_del(s_render.idle_timer);
+		s_render.idle_timer = NULL;
+	}
+	stats_overlay_detach();
+	toast_finalize();
+	pressure_finalize();
+	thumb_finalize();
 	view_destroy();
 	data_finalize();
+	data_destroy_resources();
+	logger_finalize();
 }
 
 static void ui_app_lang_changed(app_event_info_h event_info, void *user_data)
@@ -241,6 +376,14 @@ static void ui_app_low_battery(app_event_info_h event_info, void *user_data)
 static void ui_app_low_memory(app_event_info_h event_info, void *user_data)
 {
 	/*APP_EVENT_LOW_MEMORY*/
+	app_event_low_memory_status_e status = APP_EVENT_LOW_MEMORY_NORMAL;
+
+	if (app_event_get_low_memory_status(event_info, &status) != APP_ERROR_NONE || status == APP_EVENT_LOW_MEMORY_NORMAL) {
+		return;
+	}
+
+	LOGGER_W(LOG_TAG, "low memory (%s), %zu bytes in use", status == APP_EVENT_LOW_MEMORY_HARD_WARNING ? "hard" : "soft", pressure_total());
+	pressure_release();
 }
 
 int main(int argc, char *argv[])
@@ -262,7 +405,6 @@ int main(int argc, char *argv[])
 	ui_app_add_event_handler(&handlers[APP_EVENT_DEVICE_ORIENTATION_CHANGED], APP_EVENT_DEVICE_ORIENTATION_CHANGED, ui_app_orient_changed, &ad);
 	ui_app_add_event_handler(&handlers[APP_EVENT_LANGUAGE_CHANGED], APP_EVENT_LANGUAGE_CHANGED, ui_app_lang_changed, &ad);
 	ui_app_add_event_handler(&handlers[APP_EVENT_REGION_FORMAT_CHANGED], APP_EVENT_REGION_FORMAT_CHANGED, ui_app_region_changed, &ad);
-	ui_app_remove_event_handler(handlers[APP_EVENT_LOW_MEMORY]);
 
 	ret = ui_app_main(argc, argv, &event_callback, &ad);
 	if (ret != APP_ERROR_NONE) {
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "hellomex.h"
+#include "logger.h"
+
+typedef struct _logger_entry {
+	log_priority prio;
+	const char *tag;
+	char text[LOGGER_ENTRY_SIZE];
+} logger_entry_s;
+
+/*
+ * Every producer runs on the main loop, so the ring needs no locking.
+ * The timer is frozen while the ring is empty to avoid idle wakeups.
+ */
+static struct _s_info {
+	logger_entry_s ring[LOGGER_RING_SIZE];
+	unsigned int head;
+	unsigned int tail;
+	unsigned int dropped;
+	Ecore_Timer *timer;
+	bool frozen;
+} s_info = {
+	.head = 0,
+	.tail = 0,
+	.dropped = 0,
+	.timer = NULL,
+	.frozen = false,
+};
+
+static void _flush(unsigned int max)
+{
+	while (s_info.tail != s_info.head && max--) {
+		logger_entry_s *entry = &s_info.ring[s_info.tail % LOGGER_RING_SIZE];
+
+		dlog_print(entry->prio, entry->tag, "%s", entry->text);
+		s_info.tail++;
+	}
+
+	if (s_info.dropped) {
+		dlog_print(DLOG_WARN, LOG_TAG, "logger ring full, %u messages dropped", s_info.dropped);
+		s_info.dropped = 0;
+	}
+}
+
+static Eina_Bool _flush_timer_cb(void *data)
+{
+	_flush(LOGGER_FLUSH_BATCH);
+
+	if (s_info.tail == s_info.head) {
+		ecore_timer_freeze(s_info.timer);
+		s_info.frozen = true;
+	}
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+/*
+ * @brief: Create the flush timer
+ */
+void logger_initialize(void)
+{
+	if (s_info.timer) {
+		return;
+	}
+
+	s_info.timer = ecore_timer_add(LOGGER_FLUSH_INTERVAL, _flush_timer_cb, NULL);
+	if (s_info.timer == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to create the logger timer");
+		return;
+	}
+
+	ecore_timer_freeze(s_info.timer);
+	s_info.frozen = true;
+}
+
+/*
+ * @brief: Write out the queued messages and delete the flush timer
+ */
+void logger_finalize(void)
+{
+	if (s_info.timer == NULL) {
+		return;
+	}
+
+	ecore_timer_del(s_info.timer);
+	s_info.timer = NULL;
+	_flush(LOGGER_RING_SIZE);
+}
+
+/*
+ * @brief: Queue a message for the next flush
+ * @param[prio]: dlog priority
+ * @param[tag]: Log tag, must outlive the flush
+ * @param[fmt]: printf format
+ * Messages longer than LOGGER_ENTRY_SIZE are truncated, messages arriving
+ * while the ring is full are counted and dropped.
+ */
+void logger_write(log_priority prio, const char *tag, const char *fmt, ...)
+{
+	logger_entry_s *entry = NULL;
+	va_list ap;
+
+	va_start(ap, fmt);
+
+	if (s_info.timer == NULL) {
+		dlog_vprint(prio, tag, fmt, ap);
+		va_end(ap);
+		return;
+	}
+
+	if (s_info.head - s_info.tail >= LOGGER_RING_SIZE) {
+		s_info.dropped++;
+		va_end(ap);
+		return;
+	}
+
+	entry = &s_info.ring[s_info.head % LOGGER_RING_SIZE];
+	entry->prio = prio;
+	entry->tag = tag;
+	vsnprintf(entry->text, sizeof(entry->text), fmt, ap);
+	s_info.head++;
+	va_end(ap);
+
+	if (s_info.frozen) {
+		ecore_timer_thaw(s_info.timer);
+		s_info.frozen = false;
+	}
+}
+
+/*
+ * @brief: Bytes held by the logger, the ring included
+ */
+size_t logger_memory(void)
+{
+	return sizeof(s_info);
+}
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+#include "hellomex.h"
+#include "logger.h"
+#include "outbox.h"
+#include "stream.h"
+
+/*
+ * Two lanes share the link. Key and control messages are copied into a
+ * FIFO and always go first. Motion is never queued as bytes: a poll only
+ * marks the lane pending and the message is built from the sample ring
+ * when the lane gets its turn, so a backlog of polls collapses into one
+ * message with the newest samples.
+ */
+typedef struct _outbox_control {
+	int len;
+	unsigned char data[OUTBOX_CONTROL_SIZE];
+} outbox_control_s;
+
+typedef struct _outbox_inflight {
+	int transaction_id;
+	double sent;
+} outbox_inflight_s;
+
+static struct _s_info {
+	outbox_send_cb send;
+	outbox_build_cb build_motion;
+	outbox_control_s control[OUTBOX_CONTROL_MAX];
+	unsigned int control_head;
+	unsigned int control_tail;
+	unsigned int control_attempts;
+	bool motion_pending;
+	unsigned int motion_merged;
+	outbox_inflight_s inflight[OUTBOX_INFLIGHT_MAX];
+	Ecore_Timer *retry_timer;
+	unsigned char motion_buf[STREAM_MESSAGE_MAX];
+} s_info = {
+	.send = NULL,
+	.build_motion = NULL,
+	.control_head = 0,
+	.control_tail = 0,
+	.motion_pending = false,
+	.retry_timer = NULL,
+};
+
+static void _drain(void);
+
+/*
+ * Returns a free in flight slot, expiring sends whose status never came
+ */
+static outbox_inflight_s *_free_slot(void)
+{
+	double now = ecore_time_get();
+	int i;
+
+	for (i = 0; i < OUTBOX_INFLIGHT_MAX; i++) {
+		outbox_inflight_s *slot = &s_info.inflight[i];
+
+		if (slot->transaction_id > 0 && now - slot->sent > OUTBOX_INFLIGHT_TIMEOUT)
+			slot->transaction_id = 0;
+		if (slot->transaction_id <= 0)
+			return slot;
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns the send callback result, the transaction id on success
+ */
+static int _send(outbox_inflight_s *slot, unsigned char *buf, int len)
+{
+	int id = s_info.send(buf, len);
+
+	if (id <= 0) {
+		return id;
+	}
+
+	slot->transaction_id = id;
+	slot->sent = ecore_time_get();
+
+	return id;
+}
+
+static Eina_Bool _retry_timer_cb(void *data)
+{
+	s_info.retry_timer = NULL;
+	_drain();
+
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _drain(void)
+{
+	outbox_inflight_s *slot = NULL;
+	int len = 0;
+
+	if (s_info.send == NULL) {
+		return;
+	}
+
+	while ((slot = _free_slot()) != NULL) {
+		if (s_info.control_tail != s_info.control_head) {
+			outbox_control_s *msg = &s_info.control[s_info.control_tail % OUTBOX_CONTROL_MAX];
+			int ret = _send(slot, msg->data, msg->len);
+
+			/*
+			 * A key release must not get lost, a failed send stays at the
+			 * head and goes again from the retry timer
+			 */
+			if (ret <= 0)
+				s_info.control_attempts++;
+			if (ret == 0 && s_info.control_attempts < OUTBOX_CONTROL_ATTEMPTS) {
+				break;
+			}
+
+			if (ret <= 0)
+				dlog_print(DLOG_ERROR, LOG_TAG, "control message dropped after %u attempts (%d)", s_info.control_attempts, ret);
+			s_info.control_tail++;
+			s_info.control_attempts = 0;
+			continue;
+		}
+
+		if (!s_info.motion_pending) {
+			break;
+		}
+
+		s_info.motion_pending = false;
+		len = s_info.build_motion(s_info.motion_buf, sizeof(s_info.motion_buf));
+		if (len > 0)
+			_send(slot, s_info.motion_buf, len);
+	}
+
+	if ((s_info.control_tail != s_info.control_head || s_info.motion_pending) && s_info.retry_timer == NULL)
+		s_info.retry_timer = ecore_timer_add(OUTBOX_RETRY_INTERVAL, _retry_timer_cb, NULL);
+}
+
+/*
+ * @brief: Set the send and motion build callbacks
+ */
+void outbox_initialize(outbox_send_cb send, outbox_build_cb build_motion)
+{
+	s_info.send = send;
+	s_info.build_motion = build_motion;
+	s_info.control_head = 0;
+	s_info.control_tail = 0;
+	s_info.control_attempts = 0;
+	s_info.motion_pending = false;
+	memset(s_info.inflight, 0, sizeof(s_info.inflight));
+}
+
+/*
+ * @brief: Drop everything queued and stop retrying
+ */
+void outbox_finalize(void)
+{
+	if (s_info.retry_timer) {
+		ecore_timer_del(s_info.retry_timer);
+		s_info.retry_timer = NULL;
+	}
+
+	s_info.control_tail = s_info.control_head;
+	s_info.control_attempts = 0;
+	s_info.motion_pending = false;
+	s_info.send = NULL;
+}
+
+/*
+ * @brief: Queue a key or control message on the priority lane
+ * @param[buf]: Message, copied
+ * @param[len]: Message length
+ * Returns false if the message is too big or the lane is full
+ */
+bool outbox_push_control(const unsigned char *buf, int len)
+{
+	outbox_control_s *msg = NULL;
+
+	if (len <= 0 || len > OUTBOX_CONTROL_SIZE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "control message of %d bytes does not fit the outbox", len);
+		return false;
+	}
+
+	if (s_info.control_head - s_info.control_tail >= OUTBOX_CONTROL_MAX) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "control lane full, message dropped");
+		return false;
+	}
+
+	msg = &s_info.control[s_info.control_head % OUTBOX_CONTROL_MAX];
+	memcpy(msg->data, buf, len);
+	msg->len = len;
+	s_info.control_head++;
+
+	_drain();
+
+	return true;
+}
+
+/*
+ * @brief: Ask for a motion message on the bulk lane
+ * Requests made while one is still waiting are merged into it.
+ */
+void outbox_request_motion(void)
+{
+	if (s_info.motion_pending) {
+		s_info.motion_merged++;
+		LOGGER_D(LOG_TAG, "motion request merged (%u)", s_info.motion_merged);
+	}
+
+	s_info.motion_pending = true;
+	_drain();
+}
+
+/*
+ * @brief: Free the in flight slot of a send once its status is known
+ * @param[transaction_id]: Id passed to the delivery status callback
+ */
+void outbox_delivered(int transaction_id)
+{
+	int i;
+
+	for (i = 0; i < OUTBOX_INFLIGHT_MAX; i++) {
+		if (s_info.inflight[i].transaction_id == transaction_id) {
+			s_info.inflight[i].transaction_id = 0;
+			break;
+		}
+	}
+
+	_drain();
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hellomex.h"
+#include "data.h"
+#include "logger.h"
+#include "pressure.h"
+#include "stream.h"
+#include "thumb.h"
+
+typedef struct _pressure_subsystem {
+	const char *name;
+	size_t (*usage)(void);
+	size_t (*trim)(void);
+} pressure_subsystem_s;
+
+static const pressure_subsystem_s subsystems[PRESSURE_SUBSYSTEM_MAX] = {
+	[PRESSURE_ALBUMS] = { "albums", data_album_memory, data_trim_album_list },
+	[PRESSURE_THUMBNAILS] = { "thumbnails", thumb_memory, thumb_trim },
+	[PRESSURE_SAMPLES] = { "samples", stream_memory, NULL },
+	[PRESSURE_LOGS] = { "logs", logger_memory, NULL },
+};
+
+static struct _s_info {
+	size_t limit;
+	Ecore_Timer *timer;
+	bool exhausted;
+} s_info = {
+	.limit = 0,
+	.timer = NULL,
+	.exhausted = false,
+};
+
+static Eina_Bool _check_timer_cb(void *data)
+{
+	pressure_check();
+
+	/* Nothing more to give back, checking again would only repeat the release */
+	if (s_info.exhausted) {
+		LOGGER_W(LOG_TAG, "nothing released, limit check stopped");
+		s_info.timer = NULL;
+		return ECORE_CALLBACK_CANCEL;
+	}
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+/*
+ * @brief: Bytes held by one subsystem
+ * @param[subsystem]: Subsystem
+ */
+size_t pressure_usage(pressure_subsystem_e subsystem)
+{
+	if (subsystem < 0 || subsystem >= PRESSURE_SUBSYSTEM_MAX) {
+		return 0;
+	}
+
+	return subsystems[subsystem].usage();
+}
+
+/*
+ * @brief: Bytes held by every subsystem
+ */
+size_t pressure_total(void)
+{
+	size_t total = 0;
+	int i;
+
+	for (i = 0; i < PRESSURE_SUBSYSTEM_MAX; i++) {
+		total += subsystems[i].usage();
+	}
+
+	return total;
+}
+
+/*
+ * Bytes held by the subsystems with a trim hook, the fixed rings can
+ * never go below their size so they do not count against the limit
+ */
+static size_t _trimmable(void)
+{
+	size_t total = 0;
+	int i;
+
+	for (i = 0; i < PRESSURE_SUBSYSTEM_MAX; i++) {
+		if (subsystems[i].trim)
+			total += subsystems[i].usage();
+	}
+
+	return total;
+}
+
+/*
+ * @brief: Trim every subsystem that can give memory back
+ * Returns the bytes released
+ */
+size_t pressure_release(void)
+{
+	size_t released = 0;
+	int i;
+
+	for (i = 0; i < PRESSURE_SUBSYSTEM_MAX; i++) {
+		size_t freed = 0;
+
+		if (subsystems[i].trim == NULL) {
+			continue;
+		}
+
+		freed = subsystems[i].trim();
+		released += freed;
+		LOGGER_I(LOG_TAG, "%s released %zu bytes, %zu left", subsystems[i].name, freed, subsystems[i].usage());
+	}
+
+	LOGGER_W(LOG_TAG, "memory pressure: released %zu bytes, %zu in use", released, pressure_total());
+
+	return released;
+}
+
+/*
+ * @brief: Set a simulated memory limit
+ * @param[limit]: Bytes, 0 removes the limit
+ */
+void pressure_set_limit(size_t limit)
+{
+	s_info.limit = limit;
+	s_info.exhausted = false;
+
+	if (limit && s_info.timer == NULL) {
+		s_info.timer = ecore_timer_add(PRESSURE_CHECK_INTERVAL, _check_timer_cb, NULL);
+	} else if (limit == 0 && s_info.timer) {
+		ecore_timer_del(s_info.timer);
+		s_info.timer = NULL;
+	}
+}
+
+/*
+ * @brief: Release memory if the simulated limit is exceeded
+ * Only memory a trim can give back is compared against the limit.
+ * Returns true if a release ran
+ */
+bool pressure_check(void)
+{
+	size_t total = 0;
+
+	if (s_info.limit == 0) {
+		return false;
+	}
+
+	total = _trimmable();
+	if (total <= s_info.limit) {
+		return false;
+	}
+
+	LOGGER_W(LOG_TAG, "%zu trimmable bytes in use over the %zu byte limit", total, s_info.limit);
+	s_info.exhausted = pressure_release() == 0;
+
+	return true;
+}
+
+/*
+ * @brief: Stop the limit check
+ */
+void pressure_finalize(void)
+{
+	pressure_set_limit(0);
+}
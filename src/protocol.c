@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stddef.h>
+#include "protocol.h"
+
+/*
+ * @brief: Check if a received payload uses the typed protocol
+ * @param[buffer]: Payload passed to the data received callback
+ * @param[length]: Length of the payload
+ */
+bool proto_is_typed(const void *buffer, unsigned int length)
+{
+	const unsigned char *data = buffer;
+
+	return data != NULL && length >= PROTO_HEADER_SIZE && data[0] == PROTO_MAGIC;
+}
+
+/*
+ * @brief: Read the next message of a payload without copying it
+ * @param[cursor]: Unread part of the payload, advanced past the message
+ * @param[msg_out]: Type of the message and a view of its body
+ * A payload may carry several messages back to back. Reading stops at the
+ * first malformed header so a bad frame never runs past the buffer.
+ */
+proto_read_e proto_read_message(proto_view_s *cursor, proto_msg_s *msg_out)
+{
+	unsigned int body_len = 0;
+
+	if (cursor->length == 0) {
+		return PROTO_READ_END;
+	}
+
+	if (cursor->length < PROTO_HEADER_SIZE || cursor->data[0] != PROTO_MAGIC) {
+		return PROTO_READ_TRUNCATED;
+	}
+
+	body_len = cursor->data[2] | (cursor->data[3] << 8);
+	if (body_len > cursor->length - PROTO_HEADER_SIZE) {
+		return PROTO_READ_TRUNCATED;
+	}
+
+	msg_out->type = cursor->data[1];
+	msg_out->body.data = cursor->data + PROTO_HEADER_SIZE;
+	msg_out->body.length = body_len;
+
+	cursor->data += PROTO_HEADER_SIZE + body_len;
+	cursor->length -= PROTO_HEADER_SIZE + body_len;
+
+	return PROTO_READ_OK;
+}
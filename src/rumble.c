@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <device/haptic.h>
+#include "hellomex.h"
+#include "logger.h"
+#include "rumble.h"
+
+#define RUMBLE_DEFAULT_INTENSITY 100
+
+static struct _s_info {
+	haptic_device_h device;
+	haptic_effect_h effect;
+	Ecore_Timer *timer;
+	bool on;
+	int intensity;
+	double expires;
+	double last_apply;
+	/* Latest requested state, applied by _apply() */
+	bool want_on;
+	int want_intensity;
+	int want_duration;
+	double want_arrival;
+	/* Arrival to motor latency */
+	unsigned int applied;
+	unsigned int coalesced;
+	unsigned int over_budget;
+	double latency_sum;
+	double latency_max;
+} s_info = {
+	.device = NULL,
+	.effect = NULL,
+	.timer = NULL,
+	.on = false,
+};
+
+static void _apply(void)
+{
+	double now = ecore_time_get();
+	double latency = 0.0;
+	int duration = s_info.want_duration;
+	int ret = 0;
+
+	if (s_info.want_on) {
+		if (duration <= 0 || duration > RUMBLE_MAX_DURATION)
+			duration = RUMBLE_MAX_DURATION;
+
+		/* Already running at this level for long enough, nothing to do */
+		if (s_info.on && s_info.intensity == s_info.want_intensity && now + duration / 1000.0 <= s_info.expires) {
+			return;
+		}
+
+		ret = device_haptic_vibrate(s_info.device, duration, s_info.want_intensity, &s_info.effect);
+		if (ret != 0) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] device_haptic_vibrate() error: %s", __FILE__, __LINE__, get_error_message(ret));
+			return;
+		}
+		s_info.on = true;
+		s_info.intensity = s_info.want_intensity;
+		s_info.expires = now + duration / 1000.0;
+	} else {
+		if (!s_info.on) {
+			return;
+		}
+
+		ret = device_haptic_stop(s_info.device, s_info.effect);
+		if (ret != 0) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] device_haptic_stop() error: %s", __FILE__, __LINE__, get_error_message(ret));
+		}
+		s_info.on = false;
+		s_info.effect = NULL;
+	}
+
+	s_info.last_apply = ecore_time_get();
+	latency = s_info.last_apply - s_info.want_arrival;
+	s_info.applied++;
+	s_info.latency_sum += latency;
+	if (latency > s_info.latency_max)
+		s_info.latency_max = latency;
+
+	if (latency > RUMBLE_LATENCY_BUDGET) {
+		s_info.over_budget++;
+		LOGGER_W(LOG_TAG, "rumble latency %.1f ms over budget (%u of %u, %u coalesced)",
+				latency * 1000.0, s_info.over_budget, s_info.applied, s_info.coalesced);
+	}
+}
+
+static Eina_Bool _apply_timer_cb(void *data)
+{
+	s_info.timer = NULL;
+	_apply();
+
+	return ECORE_CALLBACK_CANCEL;
+}
+
+/*
+ * @brief: Open the haptic device
+ */
+void rumble_initialize(void)
+{
+	int count = 0;
+	int ret = device_haptic_get_count(&count);
+
+	if (ret != 0 || count <= 0) {
+		LOGGER_I(LOG_TAG, "no haptic device, rumble disabled");
+		return;
+	}
+
+	ret = device_haptic_open(0, &s_info.device);
+	if (ret != 0) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] device_haptic_open() error: %s", __FILE__, __LINE__, get_error_message(ret));
+		s_info.device = NULL;
+	}
+}
+
+/*
+ * @brief: Stop the motor and close the haptic device
+ */
+void rumble_finalize(void)
+{
+	if (s_info.timer) {
+		ecore_timer_del(s_info.timer);
+		s_info.timer = NULL;
+	}
+
+	if (s_info.device == NULL) {
+		return;
+	}
+
+	if (s_info.on)
+		device_haptic_stop(s_info.device, s_info.effect);
+
+	device_haptic_close(s_info.device);
+	s_info.device = NULL;
+	s_info.on = false;
+}
+
+/*
+ * @brief: Check if this device can rumble
+ */
+bool rumble_is_supported(void)
+{
+	return s_info.device != NULL;
+}
+
+/*
+ * @brief: Handle a PROTO_MSG_RUMBLE message
+ * @param[body]: Body of the message
+ * @param[arrival]: ecore_time_get() when the payload was received
+ */
+void rumble_handle_message(const proto_view_s *body, double arrival)
+{
+	unsigned int on = 0;
+	unsigned int intensity = 0;
+	unsigned int duration = 0;
+
+	if (body->length < PROTO_RUMBLE_SIZE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "short rumble message (%u)", body->length);
+		return;
+	}
+
+	proto_get_u8(body, 0, &on);
+	proto_get_u8(body, 1, &intensity);
+	proto_get_u16(body, 2, &duration);
+
+	rumble_set(on != 0, intensity, duration, arrival);
+}
+
+/*
+ * @brief: Request a motor state
+ * @param[on]: Start or stop the motor
+ * @param[intensity]: 1..100, 0 for the default
+ * @param[duration_ms]: Run time, 0 to run until stopped
+ * @param[arrival]: Time the request arrived, used for the latency budget
+ * Applied right away unless the previous change was less than
+ * RUMBLE_MIN_GAP ago. Requests landing inside that gap only replace the
+ * pending state, so a burst costs one haptic call.
+ */
+void rumble_set(bool on, int intensity, int duration_ms, double arrival)
+{
+	double since = 0.0;
+
+	if (s_info.device == NULL) {
+		return;
+	}
+
+	if (intensity <= 0 || intensity > 100)
+		intensity = RUMBLE_DEFAULT_INTENSITY;
+
+	s_info.want_on = on;
+	s_info.want_intensity = intensity;
+	s_info.want_duration = duration_ms;
+	s_info.want_arrival = arrival;
+
+	if (s_info.timer) {
+		s_info.coalesced++;
+		return;
+	}
+
+	since = ecore_time_get() - s_info.last_apply;
+	if (since < RUMBLE_MIN_GAP) {
+		s_info.timer = ecore_timer_add(RUMBLE_MIN_GAP - since, _apply_timer_cb, NULL);
+		if (s_info.timer) {
+			return;
+		}
+	}
+
+	_apply();
+}
+
+/*
+ * @brief: Get the arrival to motor latency seen so far, in seconds
+ * @param[avg_out]: Average latency
+ * @param[max_out]: Worst latency
+ */
+void rumble_get_latency(double *avg_out, double *max_out)
+{
+	if (avg_out)
+		*avg_out = s_info.applied ? s_info.latency_sum / s_info.applied : 0.0;
+	if (max_out)
+		*max_out = s_info.latency_max;
+}
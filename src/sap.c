@@ -20,8 +20,15 @@
 #include <sap_message_exchange.h>
 #include <sensor.h>
 #include <device/power.h>
+#include "calib.h"
+#include "gesture.h"
+#include "logger.h"
+#include "outbox.h"
+#include "protocol.h"
+#include "rumble.h"
+#include "stats.h"
+#include "stream.h"
 
-#define LISTENER_TIMEOUT 0
 #define MEX_PROFILE_ID "/sample/hellomessage"
 #define KEY_AMNT 7
 
@@ -29,63 +36,64 @@ static struct accel_info {
 	float x;
 	float y;
 	float z;
-	char x_array[10];
-	char y_array[10];
-	char z_array[10];
-	char c_x_array[5];
-	char c_y_array[5];
-	char c_z_array[5];
-	char key_pressed[KEY_AMNT];
+	unsigned int keys_held;
+	unsigned int keys_latched;
+	bool sampled;
+	double wakeup;	/* loop time of the last sensor wakeup */
 } a_info = {
 	.x = 0,
 	.y = 0,
 	.z = 0,
-	.key_pressed = {0},
-	.x_array = {0},
-	.y_array = {0},
-	.z_array = {0}
+	.keys_held = 0,
+	.keys_latched = 0,
+	.sampled = false,
+	.wakeup = 0.0,
 };
 
-union {
-  float float_variable;
-  char bytes_array[5];
-} float_convert;
-
 typedef struct _sensor_data {
 	sensor_h handle; //returns the handle of the sensor
 	sensor_listener_h listener; //you can create various listeners to check on a sensor
+	sensor_h gyro_handle;
+	sensor_listener_h gyro_listener;
 } sensor_data_t;
 sensor_data_t sensor;
 
-int size = 35; //sizeof(msg) * 8;
+static unsigned char tx_buf[STREAM_MESSAGE_MAX];
 
-char* getButtons(){
-	return g_strdup_printf("%s%s%s", a_info.x_array, a_info.y_array, a_info.z_array);
-}
+static void _send_gesture(const gesture_event_s *gesture);
+static void _send_calibration(void);
+static void _send_keys(void);
 
-void keyReleased(){
-	for(int i = 0; i < KEY_AMNT; i++){// Clean the key
-		a_info.key_pressed[i] = 'f';
-	}
+/*
+ * Key state is a bitmask so chords and presses from several fingers are
+ * tracked independently. A press is latched until the next message so a
+ * tap shorter than the poll interval is still reported.
+ */
+void keyReleased(int index){
+	if (index < 0 || index >= KEY_AMNT || !(a_info.keys_held & (1u << index)))
+		return;
+
+	a_info.keys_held &= ~(1u << index);
+	_send_keys();
 }
 
 
 void keyPressed(int index){
-	a_info.key_pressed[index] = 't';
-	dlog_print(DLOG_DEBUG, "PUSH", a_info.key_pressed);
-}
-
-char* getAccel(){
+	if (index < 0 || index >= KEY_AMNT)
+		return;
 
-	sprintf(a_info.x_array, "%f", a_info.x);
-	sprintf(a_info.y_array, "%f", a_info.y);
-	sprintf(a_info.z_array, "%f", a_info.z);
+	a_info.keys_held |= 1u << index;
+	a_info.keys_latched |= 1u << index;
+	stats_count(STATS_KEY_PRESSES);
+	_send_keys();
+}
 
-	//strncpy(a_info.c_x_array, a_info.x_array, 5);
-	//strncpy(a_info.c_y_array, a_info.y_array, 5);
-	//strncpy(a_info.c_z_array, a_info.z_array, 5);
+static unsigned int _take_keys(void)
+{
+	unsigned int keys = a_info.keys_held | a_info.keys_latched;
 
-	return g_strdup_printf("%s,%s,%s,%s", a_info.x_array, a_info.y_array, a_info.z_array, a_info.key_pressed);
+	a_info.keys_latched = 0;
+	return keys;
 }
 
 void turn_on_screen(){
@@ -112,6 +120,13 @@ void data_stop_sensor(void)
 		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_stop() error: %s", __FILE__, __LINE__, get_error_message(ret));
 		return;
 	}
+
+	if (sensor.gyro_listener) {
+		ret = sensor_listener_stop(sensor.gyro_listener);
+		if (ret != SENSOR_ERROR_NONE) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_stop() error: %s", __FILE__, __LINE__, get_error_message(ret));
+		}
+	}
 }
 
 void data_start_sensor()
@@ -125,13 +140,71 @@ void data_start_sensor()
 		return;
 	}
 
+	if (sensor.gyro_listener && (stream_get_config()->sensors & STREAM_SENSOR_GYRO)) {
+		ret = sensor_listener_start(sensor.gyro_listener);
+		if (ret != SENSOR_ERROR_NONE) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_start() error: %s", __FILE__, __LINE__, get_error_message(ret));
+		}
+	}
 }
 
+/*
+ * With hardware batching one wakeup delivers every reading queued in the
+ * sensor FIFO, oldest first, one callback each within the same main loop
+ * iteration, so a new loop time marks a new wakeup
+ */
 static void _sensor_event_cb(sensor_h sensor, sensor_event_s *event, void *data)
 {
+	gesture_event_s gesture;
+	double now = ecore_loop_time_get();
+
+	if (now != a_info.wakeup) {
+		a_info.wakeup = now;
+		stats_count(STATS_SENSOR_WAKEUPS);
+	}
+	stats_count(STATS_SENSOR_EVENTS);
+
+	if (!a_info.sampled) {
+		a_info.sampled = true;
+		startup_mark(STARTUP_FIRST_SAMPLE);
+	}
 	a_info.x = event->values[0];
 	a_info.y = event->values[1];
 	a_info.z = event->values[2];
+
+	if (calib_feed(event->values))
+		_send_calibration();
+	if (gesture_feed(event->timestamp, event->values, &gesture))
+		_send_gesture(&gesture);
+	if (stream_push_sample(STREAM_SENSOR_ACCEL, event->timestamp, event->values))
+		outbox_request_motion();
+}
+
+static void _gyro_event_cb(sensor_h sensor, sensor_event_s *event, void *data)
+{
+	stream_push_sample(STREAM_SENSOR_GYRO, event->timestamp, event->values);
+}
+
+/*
+ * Apply the interval and hardware batch latency of the stream configuration
+ */
+static void _set_listener_rates(sensor_listener_h listener)
+{
+	const stream_config_s *config = stream_get_config();
+	unsigned int latency = config->batch_latency_ms == STREAM_BATCH_LATENCY_OFF ? 0 : config->batch_latency_ms;
+	int ret;
+
+	ret = sensor_listener_set_interval(listener, config->interval_ms);
+	if (ret != SENSOR_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_set_interval() error: %s", __FILE__, __LINE__, get_error_message(ret));
+	}
+
+	ret = sensor_listener_set_max_batch_latency(listener, latency);
+	if (ret == SENSOR_ERROR_NOT_SUPPORTED) {
+		LOGGER_I(LOG_TAG, "sensor has no FIFO, batching disabled");
+	} else if (ret != SENSOR_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_set_max_batch_latency() error: %s", __FILE__, __LINE__, get_error_message(ret));
+	}
 }
 
 void data_get_sensor_data(sensor_type_e type)
@@ -147,9 +220,8 @@ void data_get_sensor_data(sensor_type_e type)
 void initialize_sensors(void)
 {
 	int ret;
-	int i = SENSOR_ACCELEROMETER;
 
-	ret = sensor_get_default_sensor(i, &sensor.handle); // Create the handle
+	ret = sensor_get_default_sensor(SENSOR_ACCELEROMETER, &sensor.handle); // Create the handle
 	if (ret != SENSOR_ERROR_NONE) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_get_default_sensor() error: %s", __FILE__, __LINE__, get_error_message(ret));
 	}
@@ -159,10 +231,54 @@ void initialize_sensors(void)
 		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_create_listener() error: %s", __FILE__, __LINE__, get_error_message(ret));
 	}
 
-	ret = sensor_listener_set_event_cb(sensor.listener, LISTENER_TIMEOUT, _sensor_event_cb, (void *)i); //Set the event when listener is called
+	ret = sensor_listener_set_event_cb(sensor.listener, 0, _sensor_event_cb, NULL); //Set the event when listener is called
 	if (ret != SENSOR_ERROR_NONE) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_set_event_cb() error: %s", __FILE__, __LINE__, get_error_message(ret));
 	}
+	_set_listener_rates(sensor.listener);
+
+	/* Gyro is optional, the stream falls back to accelerometer only without it */
+	ret = sensor_get_default_sensor(SENSOR_GYROSCOPE, &sensor.gyro_handle);
+	if (ret == SENSOR_ERROR_NONE) {
+		ret = sensor_create_listener(sensor.gyro_handle, &sensor.gyro_listener);
+		if (ret != SENSOR_ERROR_NONE) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_create_listener() error: %s", __FILE__, __LINE__, get_error_message(ret));
+			sensor.gyro_listener = NULL;
+		}
+	}
+
+	if (sensor.gyro_listener) {
+		ret = sensor_listener_set_event_cb(sensor.gyro_listener, 0, _gyro_event_cb, NULL);
+		if (ret != SENSOR_ERROR_NONE) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_listener_set_event_cb() error: %s", __FILE__, __LINE__, get_error_message(ret));
+		}
+		_set_listener_rates(sensor.gyro_listener);
+	}
+
+	stream_set_supported_sensors(sensor.gyro_listener ? STREAM_SENSOR_ALL : STREAM_SENSOR_ACCEL);
+
+	data_start_sensor();
+}
+
+/*
+ * Apply the sensor interval, batch latency and sensor set of the stream configuration
+ */
+void configure_sensors(void)
+{
+	const stream_config_s *config = stream_get_config();
+
+	if (sensor.listener == NULL) {
+		/* Picked up by initialize_sensors() */
+		return;
+	}
+
+	_set_listener_rates(sensor.listener);
+
+	if (sensor.gyro_listener) {
+		_set_listener_rates(sensor.gyro_listener);
+	} else if (config->sensors & STREAM_SENSOR_GYRO) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "gyroscope is not available");
+	}
 
 	data_start_sensor();
 }
@@ -177,7 +293,18 @@ void data_finalize(void)
 	if (ret != SENSOR_ERROR_NONE) {
 		dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_get_default_sensor() error: %s", __FILE__, __LINE__, get_error_message(ret));
 	}
+	sensor.listener = NULL;
+
+	if (sensor.gyro_listener) {
+		ret = sensor_destroy_listener(sensor.gyro_listener);
+		if (ret != SENSOR_ERROR_NONE) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "[%s:%d] sensor_destroy_listener() error: %s", __FILE__, __LINE__, get_error_message(ret));
+		}
+		sensor.gyro_listener = NULL;
+	}
 
+	outbox_finalize();
+	rumble_finalize();
 	release_screen();
 
 }
@@ -185,6 +312,7 @@ void data_finalize(void)
 struct priv {
 	sap_agent_h agent;
 	sap_peer_agent_h peer_agent;
+	sap_peer_agent_h unsupported_peer;	/* peer already reported as lacking MEX */
 };
 
 gboolean is_agent_added = FALSE;
@@ -194,36 +322,183 @@ void mex_message_delivery_status_cb(sap_peer_agent_h peer_agent_h, int transacti
 
 void mex_message_delivery_status_cb(sap_peer_agent_h peer_agent_h, int transaction_id, sap_connectionless_transfer_status_e status, void *user_data)
 {
-	dlog_print(DLOG_DEBUG, TAG, "sap_pa_message_delivery_status_cb:  transaction_id:%d, status:%d", transaction_id, status);
+	LOGGER_D(TAG, "sap_pa_message_delivery_status_cb:  transaction_id:%d, status:%d", transaction_id, status);
+	stats_mark_delivered(transaction_id, status == SAP_CONNECTIONLESS_TRANSFER_STATUS_SUCCESS);
+	outbox_delivered(transaction_id);
 }
 
-void mex_send(char *message, int length, gboolean is_secured)
+/*
+ * Returns the transaction id, 0 if the send failed and may be retried,
+ * or -1 if the peer cannot take messages at all
+ */
+int mex_send(unsigned char *message, int length, gboolean is_secured)
 {
-	int result;
+	int result = 0;
 	sap_peer_agent_h pa = priv_data.peer_agent;
 
 	if (sap_peer_agent_is_feature_enabled(pa, SAP_FEATURE_MESSAGE)) {
-		result = sap_peer_agent_send_data(pa, (unsigned char *)message, length, is_secured, mex_message_delivery_status_cb, NULL);
-		if (result <= 0) {
-			dlog_print(DLOG_DEBUG, TAG, "Error in sending mex data");
-			free(message);
-			dlog_print(DLOG_DEBUG, TAG, "try again or check error val , %d", result);
+		result = sap_peer_agent_send_data(pa, message, length, is_secured, mex_message_delivery_status_cb, NULL);
+		if (result > 0) {
+			stats_mark_sent(result);
+		} else {
+			stats_count(STATS_SEND_FAILURES);
+			LOGGER_D(TAG, "Error in sending mex data");
+			LOGGER_D(TAG, "try again or check error val , %d", result);
+			result = 0;
 		}
 	} else {
-		dlog_print(DLOG_DEBUG, TAG, "MEX is not supported by the Peer framework");
-		update_ui("Message feature is not supported by the Peer");
+		LOGGER_D(TAG, "MEX is not supported by the Peer framework");
+		/* Every poll lands here, tell the user once per peer */
+		if (priv_data.unsupported_peer != pa) {
+			priv_data.unsupported_peer = pa;
+			update_ui("Message feature is not supported by the Peer");
+		}
 		//Fallback to socket connection
+		result = -1;
 	}
 
+	return result;
+}
+
+static int _outbox_send(unsigned char *buf, int len)
+{
+	return mex_send(buf, len, FALSE);
+}
+
+/*
+ * Motion is built when the bulk lane gets its turn, so it always carries
+ * the newest samples and key state
+ */
+static int _build_motion(unsigned char *buf, int buf_size)
+{
+	return stream_build_message(_take_keys(), KEY_AMNT, buf, buf_size);
+}
+
+/*
+ * Handle a typed control message
+ * Returns TRUE if the message was a poll and should be answered with samples
+ */
+static gboolean _handle_control_message(const proto_msg_s *msg, double arrival)
+{
+	stream_config_s config = { 0, };
+	int len = 0;
+
+	switch (msg->type) {
+	case PROTO_MSG_POLL:
+		return TRUE;
+
+	case PROTO_MSG_CONFIG:
+		if (stream_parse_config(&msg->body, &config))
+			stream_set_config(&config);
+		len = stream_build_config_ack(tx_buf, sizeof(tx_buf));
+		if (len > 0)
+			outbox_push_control(tx_buf, len);
+		return FALSE;
+
+	case PROTO_MSG_RUMBLE:
+		rumble_handle_message(&msg->body, arrival);
+		return FALSE;
+
+	case PROTO_MSG_GESTURES:
+		gesture_handle_message(&msg->body);
+		return FALSE;
+
+	case PROTO_MSG_CALIBRATE:
+		calib_handle_message(&msg->body);
+		return FALSE;
+
+	case PROTO_MSG_REDUNDANCY:
+		stream_handle_redundancy(&msg->body);
+		return FALSE;
+
+	case PROTO_MSG_DEADBAND:
+		stream_handle_deadband(&msg->body);
+		return FALSE;
+
+	case PROTO_MSG_HELLO:
+		stream_negotiate(&msg->body);
+		len = stream_build_hello_ack(tx_buf, sizeof(tx_buf));
+		if (len > 0)
+			outbox_push_control(tx_buf, len);
+		return FALSE;
+
+	default:
+		LOGGER_D(TAG, "unknown message type 0x%x", msg->type);
+		return FALSE;
+	}
+}
+
+/*
+ * Gestures are pushed as soon as they are recognised instead of waiting
+ * for the next poll
+ */
+static void _send_gesture(const gesture_event_s *gesture)
+{
+	int len = 0;
+
+	if (priv_data.peer_agent == NULL)
+		return;
+
+	len = gesture_build_message(gesture, tx_buf, sizeof(tx_buf));
+	if (len > 0)
+		outbox_push_control(tx_buf, len);
+}
+
+static void _send_calibration(void)
+{
+	int len = 0;
+
+	if (priv_data.peer_agent == NULL)
+		return;
+
+	len = calib_build_message(tx_buf, sizeof(tx_buf));
+	if (len > 0)
+		outbox_push_control(tx_buf, len);
+}
+
+/*
+ * Key changes jump ahead of motion on the priority lane
+ */
+static void _send_keys(void)
+{
+	int len = 0;
+
+	if (priv_data.peer_agent == NULL)
+		return;
+
+	len = stream_build_keys(a_info.keys_held, KEY_AMNT, tx_buf, sizeof(tx_buf));
+	if (len > 0)
+		outbox_push_control(tx_buf, len);
 }
 
 void mex_data_received_cb(sap_peer_agent_h peer_agent,unsigned int payload_length,void *buffer, void *user_data)
 {
+	double arrival = ecore_time_get();
+	proto_view_s cursor = { buffer, payload_length };
+	proto_msg_s msg;
+	proto_read_e read = PROTO_READ_OK;
+	gboolean poll = FALSE;
+
 	priv_data.peer_agent = peer_agent;
-	char* msg = getAccel();
-	mex_send(msg, size, FALSE);
-	keyReleased();
-	g_free(msg);
+
+	/* Anything without the magic byte is a poll from an older phone build */
+	if (!proto_is_typed(buffer, payload_length)) {
+		poll = TRUE;
+	} else {
+		while ((read = proto_read_message(&cursor, &msg)) == PROTO_READ_OK) {
+			if (_handle_control_message(&msg, arrival))
+				poll = TRUE;
+		}
+
+		if (read == PROTO_READ_TRUNCATED)
+			dlog_print(DLOG_ERROR, TAG, "dropped %u malformed bytes", cursor.length);
+	}
+
+	if (!poll)
+		return;
+	stats_count(STATS_POLLS);
+	render_streaming_active();
+	outbox_request_motion();
 }
 
 void on_peer_agent_updated(sap_peer_agent_h peer_agent,
@@ -233,7 +508,7 @@ void on_peer_agent_updated(sap_peer_agent_h peer_agent,
 {
 	switch (result) {
 	case SAP_PEER_AGENT_FOUND_RESULT_DEVICE_NOT_CONNECTED:
-		dlog_print(DLOG_DEBUG, TAG, "device is not connected");
+		LOGGER_D(TAG, "device is not connected");
 		break;
 
 	case SAP_PEER_AGENT_FOUND_RESULT_FOUND:
@@ -247,15 +522,15 @@ void on_peer_agent_updated(sap_peer_agent_h peer_agent,
 		break;
 
 	case SAP_PEER_AGENT_FOUND_RESULT_SERVICE_NOT_FOUND:
-		dlog_print(DLOG_DEBUG, TAG, "service not found");
+		LOGGER_D(TAG, "service not found");
 		break;
 
 	case SAP_PEER_AGENT_FOUND_RESULT_TIMEDOUT:
-		dlog_print(DLOG_DEBUG, TAG, "peer agent find timed out");
+		LOGGER_D(TAG, "peer agent find timed out");
 		break;
 
 	case SAP_PEER_AGENT_FOUND_RESULT_INTERNAL_ERROR:
-		dlog_print(DLOG_DEBUG, TAG, "peer agent find search failed");
+		LOGGER_D(TAG, "peer agent find search failed");
 		break;
 	}
 }
@@ -267,11 +542,11 @@ static gboolean _find_peer_agent()
 	result = sap_agent_find_peer_agent(priv_data.agent, on_peer_agent_updated, NULL);
 
 	if (result == SAP_RESULT_SUCCESS) {
-		dlog_print(DLOG_DEBUG, TAG, "find peer call succeeded");
+		LOGGER_D(TAG, "find peer call succeeded");
 	} else {
-		dlog_print(DLOG_DEBUG, TAG, "findsap_peer_agent_s is failed (%d)", result);
+		LOGGER_D(TAG, "findsap_peer_agent_s is failed (%d)", result);
 	}
-	dlog_print(DLOG_DEBUG, TAG, "find peer call is over");
+	LOGGER_D(TAG, "find peer call is over");
 	return FALSE;
 }
 
@@ -281,7 +556,7 @@ static void on_agent_initialized(sap_agent_h agent,
 {
 	switch (result) {
 	case SAP_AGENT_INITIALIZED_RESULT_SUCCESS:
-		dlog_print(DLOG_INFO, TAG, "agent is initialized");
+		LOGGER_I(TAG, "agent is initialized");
 
 		priv_data.agent = agent;
 		sap_agent_set_data_received_cb(agent, mex_data_received_cb, NULL);
@@ -291,23 +566,23 @@ static void on_agent_initialized(sap_agent_h agent,
 		break;
 
 	case SAP_AGENT_INITIALIZED_RESULT_DUPLICATED:
-		dlog_print(DLOG_DEBUG, TAG, "duplicate registration");
+		LOGGER_D(TAG, "duplicate registration");
 		break;
 
 	case SAP_AGENT_INITIALIZED_RESULT_INVALID_ARGUMENTS:
-		dlog_print(DLOG_DEBUG, TAG, "invalid arguments");
+		LOGGER_D(TAG, "invalid arguments");
 		break;
 
 	case SAP_AGENT_INITIALIZED_RESULT_INTERNAL_ERROR:
-		dlog_print(DLOG_DEBUG, TAG, "internal sap error");
+		LOGGER_D(TAG, "internal sap error");
 		break;
 
 	default:
-		dlog_print(DLOG_DEBUG, TAG, "unknown status (%d)", result);
+		LOGGER_D(TAG, "unknown status (%d)", result);
 		break;
 	}
 
-	dlog_print(DLOG_DEBUG, TAG, "agent initialized callback is over");
+	LOGGER_D(TAG, "agent initialized callback is over");
 
 }
 
@@ -316,11 +591,11 @@ static void on_device_status_changed(sap_device_status_e status, sap_transport_t
 {
 	switch (transport_type) {
 	case SAP_TRANSPORT_TYPE_BT:
-		dlog_print(DLOG_INFO, TAG, "connectivity type(%d): bt", transport_type);
+		LOGGER_I(TAG, "connectivity type(%d): bt", transport_type);
 
 		switch (status) {
 		case SAP_DEVICE_STATUS_DETACHED:
-			dlog_print(DLOG_DEBUG, TAG, "DEVICE GOT DISCONNECTED");
+			LOGGER_D(TAG, "DEVICE GOT DISCONNECTED");
 			sap_peer_agent_destroy(priv_data.peer_agent);
 			priv_data.peer_agent = NULL;
 			break;
@@ -329,18 +604,18 @@ static void on_device_status_changed(sap_device_status_e status, sap_transport_t
 			if (is_agent_added == TRUE) {
 				_find_peer_agent();
 			}
-			dlog_print(DLOG_DEBUG, TAG, "DEVICE IS CONNECTED NOW, PLEASE CALL FIND PEER");
+			LOGGER_D(TAG, "DEVICE IS CONNECTED NOW, PLEASE CALL FIND PEER");
 			break;
 
 		default:
-			dlog_print(DLOG_DEBUG, TAG, "unknown status (%d)", status);
+			LOGGER_D(TAG, "unknown status (%d)", status);
 			break;
 		}
 
 		break;
 
 	default:
-		dlog_print(DLOG_DEBUG, TAG, "unknown connectivity type (%d)", transport_type);
+		LOGGER_D(TAG, "unknown connectivity type (%d)", transport_type);
 		break;
 	}
 }
@@ -352,7 +627,7 @@ gboolean agent_initialize()
 	do {
 		result = sap_agent_initialize(priv_data.agent, MEX_PROFILE_ID, SAP_AGENT_ROLE_PROVIDER,
 					      on_agent_initialized, NULL);
-		dlog_print(DLOG_DEBUG, TAG, "SAP >>> getRegisteredServiceAgent() >>> %d", result);
+		LOGGER_D(TAG, "SAP >>> getRegisteredServiceAgent() >>> %d", result);
 	} while (result != SAP_RESULT_SUCCESS);
 
 	return TRUE;
@@ -365,14 +640,19 @@ void initialize_sap()
 	sap_agent_create(&agent);
 
 	if (agent == NULL)
-		dlog_print(DLOG_DEBUG, TAG, "ERROR in creating agent");
+		LOGGER_D(TAG, "ERROR in creating agent");
 	else
-		dlog_print(DLOG_DEBUG, TAG, "successfully created sap agent");
+		LOGGER_D(TAG, "successfully created sap agent");
 
 	priv_data.agent = agent;
 
 	sap_set_device_status_changed_cb(on_device_status_changed, NULL);
 
+	rumble_initialize();
+	outbox_initialize(_outbox_send, _build_motion);
 	agent_initialize();
+	stream_initialize();
+	gesture_initialize();
+	calib_initialize();
 	initialize_sensors();
 }
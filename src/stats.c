@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include "hellomex.h"
+#include "view.h"
+#include "stats.h"
+
+#define PART_STATS "stats"
+#define SIGNAL_TOGGLE "stats,toggle"
+#define SIGNAL_SHOW "stats,show"
+#define SIGNAL_HIDE "stats,hide"
+
+typedef struct _stats_inflight {
+	int transaction_id;
+	unsigned int sent_ms;
+} stats_inflight_s;
+
+static struct _s_info {
+	/* Written from the hot path */
+	unsigned int counters[STATS_COUNTER_MAX];
+	unsigned int hist[STATS_HIST_MAX][STATS_BUCKETS];
+	stats_inflight_s inflight[STATS_INFLIGHT_MAX];
+	/* Overlay, main loop only */
+	Evas_Object *layout;
+	Ecore_Timer *timer;
+	bool visible;
+	double last_refresh;
+	unsigned int last_counters[STATS_COUNTER_MAX];
+	unsigned int last_hist[STATS_HIST_MAX][STATS_BUCKETS];
+} s_info = {
+	.layout = NULL,
+	.timer = NULL,
+	.visible = false,
+};
+
+static unsigned int _bucket(unsigned int value)
+{
+	unsigned int bucket = 0;
+
+	/* 0 -> 0, 1 -> 1, 2..3 -> 2, 4..7 -> 3 ... */
+	while (value && bucket < STATS_BUCKETS - 1) {
+		value >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/*
+ * @brief: Count one event
+ * @param[counter]: Counter to increment
+ */
+void stats_count(stats_counter_e counter)
+{
+	__atomic_fetch_add(&s_info.counters[counter], 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * @brief: Add one value to a histogram
+ * @param[hist]: Histogram to record in
+ * @param[value]: Value, bucketed by powers of two
+ */
+void stats_record(stats_hist_e hist, unsigned int value)
+{
+	__atomic_fetch_add(&s_info.hist[hist][_bucket(value)], 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * @brief: Remember when a message went out
+ * @param[transaction_id]: Id returned by sap_peer_agent_send_data()
+ */
+void stats_mark_sent(int transaction_id)
+{
+	stats_inflight_s *slot = &s_info.inflight[(unsigned int)transaction_id % STATS_INFLIGHT_MAX];
+
+	stats_count(STATS_SENDS);
+	__atomic_store_n(&slot->sent_ms, (unsigned int)(ecore_time_get() * 1000.0), __ATOMIC_RELAXED);
+	__atomic_store_n(&slot->transaction_id, transaction_id, __ATOMIC_RELEASE);
+}
+
+/*
+ * @brief: Record the delivery status of a message
+ * @param[transaction_id]: Id passed to the delivery status callback
+ * @param[delivered]: false if the transfer failed
+ * Statuses for sends that were already overwritten in the table are
+ * counted but do not add a latency sample.
+ */
+void stats_mark_delivered(int transaction_id, bool delivered)
+{
+	stats_inflight_s *slot = &s_info.inflight[(unsigned int)transaction_id % STATS_INFLIGHT_MAX];
+	unsigned int sent_ms = 0;
+
+	if (!delivered) {
+		stats_count(STATS_SEND_FAILURES);
+		return;
+	}
+
+	stats_count(STATS_DELIVERED);
+	if (__atomic_load_n(&slot->transaction_id, __ATOMIC_ACQUIRE) != transaction_id) {
+		return;
+	}
+
+	sent_ms = __atomic_load_n(&slot->sent_ms, __ATOMIC_RELAXED);
+	stats_record(STATS_HIST_DELIVERY_MS, (unsigned int)(ecore_time_get() * 1000.0) - sent_ms);
+}
+
+/*
+ * Upper bound of the bucket holding the given fraction of the values
+ * recorded since the last refresh
+ */
+static unsigned int _percentile(const unsigned int *delta, unsigned int total, unsigned int percent)
+{
+	unsigned int want = (total * percent + 99) / 100;
+	unsigned int seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < STATS_BUCKETS; i++) {
+		seen += delta[i];
+		if (seen >= want && seen)
+			return i ? (1u << i) - 1 : 0;
+	}
+
+	return 0;
+}
+
+static void _snapshot(void)
+{
+	int h;
+	int i;
+
+	for (i = 0; i < STATS_COUNTER_MAX; i++)
+		s_info.last_counters[i] = __atomic_load_n(&s_info.counters[i], __ATOMIC_RELAXED);
+	for (h = 0; h < STATS_HIST_MAX; h++) {
+		for (i = 0; i < STATS_BUCKETS; i++)
+			s_info.last_hist[h][i] = __atomic_load_n(&s_info.hist[h][i], __ATOMIC_RELAXED);
+	}
+	s_info.last_refresh = ecore_time_get();
+}
+
+static void _refresh(void)
+{
+	unsigned int rate[STATS_COUNTER_MAX];
+	unsigned int delta[STATS_HIST_MAX][STATS_BUCKETS];
+	unsigned int total[STATS_HIST_MAX] = { 0, };
+	unsigned int depth_max = 0;
+	char text[256] = { 0, };
+	double now = ecore_time_get();
+	double elapsed = now - s_info.last_refresh;
+	int h;
+	int i;
+
+	if (elapsed <= 0.0)
+		elapsed = STATS_REFRESH_INTERVAL;
+
+	for (i = 0; i < STATS_COUNTER_MAX; i++) {
+		unsigned int value = __atomic_load_n(&s_info.counters[i], __ATOMIC_RELAXED);
+
+		rate[i] = (unsigned int)((value - s_info.last_counters[i]) / elapsed + 0.5);
+		s_info.last_counters[i] = value;
+	}
+
+	for (h = 0; h < STATS_HIST_MAX; h++) {
+		for (i = 0; i < STATS_BUCKETS; i++) {
+			unsigned int value = __atomic_load_n(&s_info.hist[h][i], __ATOMIC_RELAXED);
+
+			delta[h][i] = value - s_info.last_hist[h][i];
+			s_info.last_hist[h][i] = value;
+			total[h] += delta[h][i];
+		}
+	}
+
+	for (i = STATS_BUCKETS - 1; i >= 0; i--) {
+		if (delta[STATS_HIST_QUEUE_DEPTH][i]) {
+			depth_max = i ? (1u << i) - 1 : 0;
+			break;
+		}
+	}
+
+	snprintf(text, sizeof(text),
+			"in %u/s  wake %u/s  poll %u/s<br>tx %u/s  fail %u/s<br>lat p50 %u p95 %u ms<br>queue &lt;=%u  keys %u/s",
+			rate[STATS_SENSOR_EVENTS], rate[STATS_SENSOR_WAKEUPS], rate[STATS_POLLS],
+			rate[STATS_SENDS], rate[STATS_SEND_FAILURES],
+			_percentile(delta[STATS_HIST_DELIVERY_MS], total[STATS_HIST_DELIVERY_MS], 50),
+			_percentile(delta[STATS_HIST_DELIVERY_MS], total[STATS_HIST_DELIVERY_MS], 95),
+			depth_max, rate[STATS_KEY_PRESSES]);
+
+	view_set_text(s_info.layout, PART_STATS, text);
+	s_info.last_refresh = now;
+}
+
+static Eina_Bool _refresh_timer_cb(void *data)
+{
+	_refresh();
+
+	return ECORE_CALLBACK_RENEW;
+}
+
+static void _toggle_cb(void *data, Evas_Object *obj, const char *emission, const char *source)
+{
+	stats_overlay_set_visible(!s_info.visible);
+}
+
+/*
+ * @brief: Hook the overlay into the main layout
+ * @param[layout]: Layout created from the main group
+ */
+void stats_overlay_attach(Evas_Object *layout)
+{
+	if (layout == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "layout is NULL.");
+		return;
+	}
+
+	s_info.layout = layout;
+	elm_object_signal_callback_add(layout, SIGNAL_TOGGLE, "*", _toggle_cb, NULL);
+}
+
+/*
+ * @brief: Show or hide the overlay
+ * @param[visible]: true to show it
+ * The refresh timer only runs while the overlay is shown.
+ */
+void stats_overlay_set_visible(bool visible)
+{
+	if (s_info.layout == NULL || visible == s_info.visible) {
+		return;
+	}
+
+	s_info.visible = visible;
+	elm_object_signal_emit(s_info.layout, visible ? SIGNAL_SHOW : SIGNAL_HIDE, "");
+
+	if (visible) {
+		/* Rates start from now rather than from the last time it was shown */
+		_snapshot();
+		view_set_text(s_info.layout, PART_STATS, "...");
+		s_info.timer = ecore_timer_add(STATS_REFRESH_INTERVAL, _refresh_timer_cb, NULL);
+	} else if (s_info.timer) {
+		ecore_timer_del(s_info.timer);
+		s_info.timer = NULL;
+	}
+}
+
+/*
+ * @brief: Stop refreshing the overlay
+ */
+void stats_overlay_detach(void)
+{
+	if (s_info.timer) {
+		ecore_timer_del(s_info.timer);
+		s_info.timer = NULL;
+	}
+
+	s_info.visible = false;
+	s_info.layout = NULL;
+}
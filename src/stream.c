@@ -0,0 +1,1051 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hellomex.h"
+#include "calib.h"
+#include "gesture.h"
+#include "logger.h"
+#include "protocol.h"
+#include "rumble.h"
+#include "stats.h"
+#include "stream.h"
+
+#define EXTRA_KEY_INTERVAL "stream_interval"
+#define EXTRA_KEY_BATCH "stream_batch"
+#define EXTRA_KEY_SENSORS "stream_sensors"
+#define EXTRA_KEY_ENCODING "stream_encoding"
+#define EXTRA_KEY_MODE "stream_mode"
+#define EXTRA_KEY_BATCH_LATENCY "sensor_batch_latency"
+
+/* Weight of a new touch position in the pointer low pass filter */
+#define POINTER_SMOOTHING 0.4f
+
+/*
+ * Capabilities in use until a hello says otherwise: what a phone that only
+ * sends config messages already understands. Everything else needs the
+ * handshake.
+ */
+#define LEGACY_CAPS (PROTO_CAP_BINARY | PROTO_CAP_BATCHING | PROTO_CAP_TIMESTAMPS)
+
+typedef struct _stream_sample {
+	unsigned long long timestamp;
+	float accel[3];
+	float gyro[3];
+} stream_sample_s;
+
+/* Samples one message carried, by sequence number */
+typedef struct _stream_range {
+	unsigned int first;
+	unsigned int count;
+} stream_range_s;
+
+static struct _s_info {
+	stream_config_s config;
+	unsigned int supported_sensors;
+	unsigned int version;
+	unsigned int caps;
+	stream_sample_s ring[STREAM_RING_SIZE];
+	unsigned int write_seq;
+	unsigned int sent_seq;
+	unsigned int decimation;
+	unsigned int decimation_count;
+	float gyro[3];
+	int wheel_pos;
+	int wheel_sent_pos;
+	unsigned int wheel_timestamp;
+	unsigned int wheel_repeats;
+	float pointer_x;
+	float pointer_y;
+	bool pointer_touching;
+	bool pointer_dirty;
+	unsigned int pointer_repeats;
+	proto_redundancy_e redundancy_mode;
+	unsigned int redundancy;
+	/* Ranges of the last messages, sent_next is the oldest once full */
+	stream_range_s sent[STREAM_REDUNDANCY_MAX];
+	unsigned int sent_next;
+	unsigned int sent_used;
+	/* Dead-band reference, the last sample sent in full */
+	unsigned int deadband;
+	unsigned int idle_refresh;
+	unsigned int idle_heartbeats;
+	bool idle_ref_valid;
+	bool idle_wake;
+	unsigned int idle_keys;
+	int idle_accel[3];
+	int idle_gyro[3];
+} s_info = {
+	.config = {
+		.interval_ms = STREAM_DEFAULT_INTERVAL,
+		.batch_size = STREAM_DEFAULT_BATCH,
+		.sensors = STREAM_SENSOR_ACCEL,
+		.encoding = STREAM_ENCODING_TEXT,
+		.mode = STREAM_MODE_BUTTONS,
+		.batch_latency_ms = STREAM_BATCH_LATENCY_OFF,
+	},
+	.supported_sensors = STREAM_SENSOR_ACCEL,
+	.version = PROTO_VERSION,
+	.caps = LEGACY_CAPS,
+	.write_seq = 0,
+	.sent_seq = 0,
+	.decimation = 1,
+	.redundancy_mode = PROTO_REDUNDANCY_OFF,
+	.redundancy = 0,
+	.deadband = 0,
+	.idle_refresh = STREAM_IDLE_REFRESH,
+};
+
+static bool _leaves_deadband(const stream_sample_s *sample);
+
+static void _put_axes(unsigned char *buf, const float *values, float scale)
+{
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		float v = values[i] * scale;
+
+		if (v > 32767.0f)
+			v = 32767.0f;
+		else if (v < -32768.0f)
+			v = -32768.0f;
+
+		proto_put_u16(buf + i * 2, (unsigned int)(short)v & 0xffff);
+	}
+}
+
+static int _put_accel(unsigned char *buf, const float *accel, bool wiimote)
+{
+	if (wiimote) {
+		proto_put_u32(buf, calib_to_wiimote(accel));
+		return PROTO_SAMPLE_WIIMOTE_SIZE;
+	}
+
+	_put_axes(buf, accel, PROTO_ACCEL_SCALE);
+	return PROTO_SAMPLE_AXES_SIZE;
+}
+
+static void _put_config(unsigned char *body)
+{
+	proto_put_u16(body, s_info.config.interval_ms);
+	body[2] = s_info.config.batch_size;
+	body[3] = s_info.config.sensors;
+	body[4] = s_info.config.encoding;
+	body[5] = s_info.config.mode;
+	proto_put_u16(body + 6, s_info.config.batch_latency_ms);
+}
+
+/*
+ * @brief: Initialization function for stream module
+ */
+void stream_initialize(void)
+{
+	memset(s_info.ring, 0, sizeof(s_info.ring));
+	memset(s_info.gyro, 0, sizeof(s_info.gyro));
+	s_info.write_seq = 0;
+	s_info.sent_seq = 0;
+	s_info.sent_next = 0;
+	s_info.sent_used = 0;
+}
+
+/*
+ * @brief: Get the active stream configuration
+ */
+const stream_config_s *stream_get_config(void)
+{
+	return &s_info.config;
+}
+
+/*
+ * Fields a config without a field mask carries, the non zero ones
+ */
+static unsigned int _config_fields(const stream_config_s *config)
+{
+	unsigned int fields = 0;
+
+	if (config->fields)
+		return config->fields;
+
+	if (config->interval_ms)
+		fields |= PROTO_CONFIG_FIELD_INTERVAL;
+	if (config->batch_size)
+		fields |= PROTO_CONFIG_FIELD_BATCH;
+	if (config->sensors)
+		fields |= PROTO_CONFIG_FIELD_SENSORS;
+	if (config->encoding)
+		fields |= PROTO_CONFIG_FIELD_ENCODING;
+	if (config->mode)
+		fields |= PROTO_CONFIG_FIELD_MODE;
+	if (config->batch_latency_ms)
+		fields |= PROTO_CONFIG_FIELD_BATCH_LATENCY;
+
+	return fields;
+}
+
+/*
+ * @brief: Merge and apply a stream configuration
+ * @param[config]: Requested configuration, only the fields it names are applied
+ * Returns false if any field is out of range, in which case nothing is applied
+ */
+bool stream_set_config(const stream_config_s *config)
+{
+	stream_config_s next = s_info.config;
+	bool sensors_changed = false;
+	unsigned int fields = 0;
+
+	if (config == NULL) {
+		return false;
+	}
+
+	fields = _config_fields(config);
+
+	if (fields & PROTO_CONFIG_FIELD_INTERVAL) {
+		if (config->interval_ms > STREAM_INTERVAL_MAX) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "invalid stream interval %u", config->interval_ms);
+			return false;
+		}
+		next.interval_ms = config->interval_ms;
+	}
+
+	if (fields & PROTO_CONFIG_FIELD_BATCH) {
+		if (config->batch_size > STREAM_BATCH_MAX) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "invalid stream batch %u", config->batch_size);
+			return false;
+		}
+		next.batch_size = config->batch_size;
+	}
+
+	if (fields & PROTO_CONFIG_FIELD_SENSORS) {
+		if (!(config->sensors & STREAM_SENSOR_ACCEL) || (config->sensors & ~s_info.supported_sensors)) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "invalid stream sensors 0x%x", config->sensors);
+			return false;
+		}
+		next.sensors = config->sensors;
+	}
+
+	if (fields & PROTO_CONFIG_FIELD_ENCODING) {
+		if (config->encoding != STREAM_ENCODING_TEXT && config->encoding != STREAM_ENCODING_BINARY) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "invalid stream encoding %d", config->encoding);
+			return false;
+		}
+		next.encoding = config->encoding;
+	}
+
+	if (fields & PROTO_CONFIG_FIELD_MODE) {
+		if (config->mode != STREAM_MODE_BUTTONS && config->mode != STREAM_MODE_POINTER) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "invalid stream mode %d", config->mode);
+			return false;
+		}
+		next.mode = config->mode;
+	}
+
+	if (fields & PROTO_CONFIG_FIELD_BATCH_LATENCY) {
+		if (config->batch_latency_ms > STREAM_BATCH_LATENCY_MAX && config->batch_latency_ms != STREAM_BATCH_LATENCY_OFF) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "invalid sensor batch latency %u", config->batch_latency_ms);
+			return false;
+		}
+		next.batch_latency_ms = config->batch_latency_ms;
+	}
+
+	sensors_changed = next.interval_ms != s_info.config.interval_ms || next.sensors != s_info.config.sensors
+			|| next.batch_latency_ms != s_info.config.batch_latency_ms;
+	s_info.config = next;
+
+	LOGGER_I(LOG_TAG, "stream config: interval %u ms, batch %u, sensors 0x%x, encoding %d, mode %d, batch latency %u ms",
+			next.interval_ms, next.batch_size, next.sensors, next.encoding, next.mode, next.batch_latency_ms);
+
+	if (sensors_changed) {
+		configure_sensors();
+	}
+
+	return true;
+}
+
+/*
+ * @brief: Set the sensors available on this device
+ * @param[sensors]: Bitmask of stream_sensor_e
+ * Called once when the sensors are created, before any handshake.
+ */
+void stream_set_supported_sensors(unsigned int sensors)
+{
+	s_info.supported_sensors = sensors & STREAM_SENSOR_ALL;
+}
+
+/*
+ * @brief: Get the capabilities this build and device support
+ */
+unsigned int stream_get_local_caps(void)
+{
+	unsigned int caps = PROTO_CAP_BINARY | PROTO_CAP_BATCHING | PROTO_CAP_TIMESTAMPS | PROTO_CAP_WHEEL | PROTO_CAP_POINTER
+			| PROTO_CAP_GESTURES | PROTO_CAP_WIIMOTE | PROTO_CAP_REDUNDANCY | PROTO_CAP_DEADBAND | PROTO_CAP_KEY_EVENTS;
+
+	if (s_info.supported_sensors & STREAM_SENSOR_GYRO)
+		caps |= PROTO_CAP_GYRO;
+	if (rumble_is_supported())
+		caps |= PROTO_CAP_RUMBLE;
+
+	return caps;
+}
+
+/*
+ * @brief: Read the stream configuration from the launch request extras
+ * @param[app_control]: Launch request passed to app_control callback
+ */
+void stream_set_config_from_app_control(app_control_h app_control)
+{
+	stream_config_s config = { 0, };
+	char *value = NULL;
+
+	if (app_control_get_extra_data(app_control, EXTRA_KEY_INTERVAL, &value) == APP_CONTROL_ERROR_NONE && value) {
+		config.interval_ms = strtoul(value, NULL, 10);
+		free(value);
+		value = NULL;
+	}
+
+	if (app_control_get_extra_data(app_control, EXTRA_KEY_BATCH, &value) == APP_CONTROL_ERROR_NONE && value) {
+		config.batch_size = strtoul(value, NULL, 10);
+		free(value);
+		value = NULL;
+	}
+
+	if (app_control_get_extra_data(app_control, EXTRA_KEY_SENSORS, &value) == APP_CONTROL_ERROR_NONE && value) {
+		if (strstr(value, "accel"))
+			config.sensors |= STREAM_SENSOR_ACCEL;
+		if (strstr(value, "gyro"))
+			config.sensors |= STREAM_SENSOR_GYRO;
+		free(value);
+		value = NULL;
+	}
+
+	if (app_control_get_extra_data(app_control, EXTRA_KEY_ENCODING, &value) == APP_CONTROL_ERROR_NONE && value) {
+		if (!strcmp(value, "binary"))
+			config.encoding = STREAM_ENCODING_BINARY;
+		else if (!strcmp(value, "text"))
+			config.encoding = STREAM_ENCODING_TEXT;
+		free(value);
+		value = NULL;
+	}
+
+	if (app_control_get_extra_data(app_control, EXTRA_KEY_MODE, &value) == APP_CONTROL_ERROR_NONE && value) {
+		if (!strcmp(value, "pointer"))
+			config.mode = STREAM_MODE_POINTER;
+		else if (!strcmp(value, "buttons"))
+			config.mode = STREAM_MODE_BUTTONS;
+		free(value);
+		value = NULL;
+	}
+
+	if (app_control_get_extra_data(app_control, EXTRA_KEY_BATCH_LATENCY, &value) == APP_CONTROL_ERROR_NONE && value) {
+		config.batch_latency_ms = strtoul(value, NULL, 10);
+		if (config.batch_latency_ms == 0)
+			config.batch_latency_ms = STREAM_BATCH_LATENCY_OFF;
+		free(value);
+		value = NULL;
+	}
+
+	stream_set_config(&config);
+}
+
+/*
+ * @brief: Decode a config message body
+ * @param[body]: Body of a PROTO_MSG_CONFIG message
+ * @param[config_out]: Decoded configuration
+ */
+bool stream_parse_config(const proto_view_s *body, stream_config_s *config_out)
+{
+	unsigned int encoding = 0;
+	unsigned int mode = 0;
+
+	if (body == NULL || config_out == NULL || body->length < PROTO_CONFIG_MIN_SIZE) {
+		return false;
+	}
+
+	proto_get_u16(body, 0, &config_out->interval_ms);
+	proto_get_u8(body, 2, &config_out->batch_size);
+	proto_get_u8(body, 3, &config_out->sensors);
+	proto_get_u8(body, 4, &encoding);
+	proto_get_u8(body, 5, &mode);
+	config_out->batch_latency_ms = 0;
+	proto_get_u16(body, 6, &config_out->batch_latency_ms);
+	config_out->fields = 0;
+	if (body->length >= PROTO_CONFIG_FIELDS_SIZE) {
+		proto_get_u8(body, 8, &config_out->fields);
+		config_out->fields &= PROTO_CONFIG_FIELD_ALL;
+		/* An empty mask applies nothing, it must not fall back to the non zero fields */
+		if (config_out->fields == 0)
+			return false;
+	}
+	config_out->encoding = encoding;
+	config_out->mode = mode;
+
+	return true;
+}
+
+/*
+ * @brief: Encode the active configuration as a PROTO_MSG_CONFIG_ACK message
+ * @param[buf]: Output buffer
+ * @param[buf_size]: Size of the output buffer
+ * Returns the message length or 0 if the buffer is too small
+ */
+int stream_build_config_ack(unsigned char *buf, int buf_size)
+{
+	unsigned char *body = buf + PROTO_HEADER_SIZE;
+
+	if (buf_size < PROTO_HEADER_SIZE + PROTO_CONFIG_SIZE) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_CONFIG_ACK, PROTO_CONFIG_SIZE);
+	_put_config(body);
+
+	return PROTO_HEADER_SIZE + PROTO_CONFIG_SIZE;
+}
+
+/*
+ * @brief: Pick the fastest mode both sides support from a hello message
+ * @param[body]: Body of a PROTO_MSG_HELLO message
+ */
+bool stream_negotiate(const proto_view_s *body)
+{
+	stream_config_s config = { 0, };
+	unsigned int peer_version = 0;
+	unsigned int peer_caps = 0;
+
+	if (body == NULL || body->length < PROTO_HELLO_SIZE) {
+		return false;
+	}
+
+	proto_get_u8(body, 0, &peer_version);
+	proto_get_u16(body, 2, &peer_caps);
+	if (peer_version == 0) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "invalid peer protocol version");
+		return false;
+	}
+
+	s_info.version = peer_version < PROTO_VERSION ? peer_version : PROTO_VERSION;
+	s_info.caps = peer_caps & stream_get_local_caps();
+
+	config.encoding = (s_info.caps & PROTO_CAP_BINARY) ? STREAM_ENCODING_BINARY : STREAM_ENCODING_TEXT;
+	config.sensors = STREAM_SENSOR_ACCEL;
+	if (s_info.caps & PROTO_CAP_GYRO)
+		config.sensors |= STREAM_SENSOR_GYRO;
+	if (!(s_info.caps & PROTO_CAP_BATCHING))
+		config.batch_size = 1;
+
+	LOGGER_I(LOG_TAG, "handshake: peer v%u caps 0x%x, using v%u caps 0x%x",
+			peer_version, peer_caps, s_info.version, s_info.caps);
+
+	return stream_set_config(&config);
+}
+
+/*
+ * @brief: Encode the handshake result as a PROTO_MSG_HELLO_ACK message
+ * @param[buf]: Output buffer
+ * @param[buf_size]: Size of the output buffer
+ * Returns the message length or 0 if the buffer is too small
+ */
+int stream_build_hello_ack(unsigned char *buf, int buf_size)
+{
+	unsigned char *body = buf + PROTO_HEADER_SIZE;
+	int body_len = PROTO_HELLO_ACK_SIZE + PROTO_CONFIG_SIZE;
+
+	if (buf_size < PROTO_HEADER_SIZE + body_len) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_HELLO_ACK, body_len);
+	body[0] = s_info.version;
+	body[1] = 0;
+	proto_put_u16(body + 2, stream_get_local_caps());
+	proto_put_u16(body + 4, s_info.caps);
+	_put_config(body + PROTO_HELLO_ACK_SIZE);
+
+	return PROTO_HEADER_SIZE + body_len;
+}
+
+/*
+ * @brief: Keep only one raw accelerometer sample out of divider
+ * @param[divider]: 1 or 0 keeps every sample
+ * Used to thin the raw stream while gestures carry the interesting motion.
+ */
+void stream_set_decimation(unsigned int divider)
+{
+	s_info.decimation = divider ? divider : 1;
+	s_info.decimation_count = 0;
+}
+
+/*
+ * Repeats picked for a loss rate, one lost message in a row is by far the
+ * common case on the unreliable channel so a little goes a long way
+ */
+static unsigned int _redundancy_for_loss(unsigned int loss, unsigned int max)
+{
+	unsigned int repeats = 0;
+
+	if (loss == 0)
+		repeats = 0;
+	else if (loss < 3)
+		repeats = 1;
+	else if (loss < 10)
+		repeats = 2;
+	else if (loss < 25)
+		repeats = 3;
+	else
+		repeats = max;
+
+	return repeats < max ? repeats : max;
+}
+
+/*
+ * @brief: Handle a redundancy message from the phone
+ * @param[body]: Body of a PROTO_MSG_REDUNDANCY message
+ */
+void stream_handle_redundancy(const proto_view_s *body)
+{
+	unsigned int mode = 0;
+	unsigned int max = 0;
+	unsigned int loss = 0;
+
+	if (!proto_get_u8(body, 0, &mode)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "short redundancy message (%u)", body->length);
+		return;
+	}
+	proto_get_u8(body, 1, &max);
+	proto_get_u8(body, 2, &loss);
+
+	if (max > STREAM_REDUNDANCY_MAX)
+		max = STREAM_REDUNDANCY_MAX;
+
+	switch (mode) {
+	case PROTO_REDUNDANCY_OFF:
+		s_info.redundancy = 0;
+		break;
+	case PROTO_REDUNDANCY_FIXED:
+		s_info.redundancy = max;
+		break;
+	case PROTO_REDUNDANCY_ADAPTIVE:
+		s_info.redundancy = _redundancy_for_loss(loss, max);
+		break;
+	default:
+		dlog_print(DLOG_ERROR, LOG_TAG, "invalid redundancy mode %u", mode);
+		return;
+	}
+
+	if (mode != s_info.redundancy_mode)
+		LOGGER_I(LOG_TAG, "redundancy mode %u, %u repeats at %u%% loss", mode, s_info.redundancy, loss);
+	s_info.redundancy_mode = mode;
+}
+
+/*
+ * @brief: Handle a dead-band message from the phone
+ * @param[body]: Body of a PROTO_MSG_DEADBAND message
+ */
+void stream_handle_deadband(const proto_view_s *body)
+{
+	unsigned int deadband = 0;
+	unsigned int refresh = 0;
+
+	if (!proto_get_u16(body, 0, &deadband)) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "short dead-band message (%u)", body->length);
+		return;
+	}
+	proto_get_u8(body, 2, &refresh);
+
+	s_info.deadband = deadband;
+	s_info.idle_refresh = refresh ? refresh : STREAM_IDLE_REFRESH;
+	s_info.idle_ref_valid = false;
+	LOGGER_I(LOG_TAG, "dead-band %u, full samples every %u heartbeats", deadband, s_info.idle_refresh);
+}
+
+/*
+ * @brief: Store a sensor reading
+ * @param[sensor]: Sensor the reading comes from
+ * @param[timestamp]: Sensor timestamp in microseconds
+ * @param[values]: x, y and z values
+ * Gyro readings are attached to the next accelerometer sample.
+ * Returns true when the reading ends a still period, a motion message should
+ * go out now instead of waiting for the next poll
+ */
+bool stream_push_sample(stream_sensor_e sensor, unsigned long long timestamp, const float *values)
+{
+	stream_sample_s *sample = NULL;
+
+	if (sensor == STREAM_SENSOR_GYRO) {
+		memcpy(s_info.gyro, values, sizeof(s_info.gyro));
+		return false;
+	}
+
+	if (s_info.decimation > 1 && s_info.decimation_count++ % s_info.decimation) {
+		return false;
+	}
+
+	sample = &s_info.ring[s_info.write_seq % STREAM_RING_SIZE];
+	sample->timestamp = timestamp;
+	memcpy(sample->accel, values, sizeof(sample->accel));
+	memcpy(sample->gyro, s_info.gyro, sizeof(sample->gyro));
+	s_info.write_seq++;
+
+	return _leaves_deadband(sample);
+}
+
+/*
+ * @brief: Accumulate bezel rotation
+ * @param[detents]: Detents turned, positive clockwise
+ * @param[timestamp]: Input event time in ms
+ * Only the running position is kept, it goes out with the next message.
+ */
+void stream_push_wheel(int detents, unsigned int timestamp)
+{
+	s_info.wheel_pos += detents;
+	s_info.wheel_timestamp = timestamp;
+}
+
+/*
+ * @brief: Track the touch pointer
+ * @param[x]: Horizontal position, 0.0 to 1.0 across the layout
+ * @param[y]: Vertical position, 0.0 to 1.0 down the layout
+ * @param[touching]: false once the finger is lifted
+ * Moves are low pass filtered here and only the filtered position goes
+ * out with the next message, however many moves arrive in between.
+ */
+void stream_push_pointer(float x, float y, bool touching)
+{
+	if (x < 0.0f)
+		x = 0.0f;
+	else if (x > 1.0f)
+		x = 1.0f;
+	if (y < 0.0f)
+		y = 0.0f;
+	else if (y > 1.0f)
+		y = 1.0f;
+
+	if (touching && !s_info.pointer_touching) {
+		/* A new touch jumps, it must not glide from the last lift point */
+		s_info.pointer_x = x;
+		s_info.pointer_y = y;
+	} else if (touching) {
+		s_info.pointer_x += POINTER_SMOOTHING * (x - s_info.pointer_x);
+		s_info.pointer_y += POINTER_SMOOTHING * (y - s_info.pointer_y);
+	}
+
+	s_info.pointer_touching = touching;
+	s_info.pointer_dirty = true;
+}
+
+/*
+ * @brief: Pick the samples for the next message
+ * @param[first_out]: Sequence number of the oldest sample to send
+ * Returns the number of samples, newest batch_size samples since the last
+ * message, or the latest sample again if nothing new arrived
+ */
+static unsigned int _take_samples(unsigned int *first_out)
+{
+	unsigned int pending = s_info.write_seq - s_info.sent_seq;
+
+	stats_record(STATS_HIST_QUEUE_DEPTH, pending);
+	if (pending == 0) {
+		/* Before the first reading this is the zeroed ring[0] */
+		*first_out = s_info.write_seq ? s_info.write_seq - 1 : 0;
+		return 1;
+	}
+
+	if (pending > s_info.config.batch_size && s_info.config.batch_size)
+		pending = s_info.config.batch_size;
+	else if (pending > STREAM_BATCH_MAX)
+		pending = STREAM_BATCH_MAX;
+
+	*first_out = s_info.write_seq - pending;
+	s_info.sent_seq = s_info.write_seq;
+
+	return pending;
+}
+
+static int _build_text(unsigned int keys, int key_count, unsigned int first, unsigned int count, unsigned char *buf, int buf_size)
+{
+	char *out = (char *)buf;
+	char key_text[32] = { 0, };
+	int len = 0;
+	unsigned int i;
+
+	/* Legacy key format, one 't' or 'f' per key */
+	for (i = 0; i < (unsigned int)key_count && i < sizeof(key_text) - 1; i++)
+		key_text[i] = (keys & (1u << i)) ? 't' : 'f';
+
+	for (i = 0; i < count; i++) {
+		const stream_sample_s *sample = &s_info.ring[(first + i) % STREAM_RING_SIZE];
+		int n = snprintf(out + len, buf_size - len, "%s%f,%f,%f,%s", i ? ";" : "",
+				sample->accel[0], sample->accel[1], sample->accel[2], key_text);
+
+		if (n < 0 || n >= buf_size - len) {
+			break;
+		}
+		len += n;
+	}
+
+	return len;
+}
+
+static void _record_sent(unsigned int first, unsigned int count)
+{
+	s_info.sent[s_info.sent_next].first = first;
+	s_info.sent[s_info.sent_next].count = count;
+	s_info.sent_next = (s_info.sent_next + 1) % STREAM_REDUNDANCY_MAX;
+	if (s_info.sent_used < STREAM_REDUNDANCY_MAX)
+		s_info.sent_used++;
+}
+
+/*
+ * Pick up to max samples the previous messages carried, newest first,
+ * older than first and still in the ring. A resent sample shows up in
+ * two ranges, the sequence numbers only going down skips it.
+ * Returns the number of sequence numbers stored in seqs, oldest first
+ */
+static unsigned int _pick_repeats(unsigned int first, unsigned int max, unsigned int *seqs)
+{
+	unsigned int picked[STREAM_REDUNDANCY_MAX];
+	unsigned int count = 0;
+	unsigned int m;
+	unsigned int i;
+
+	for (m = 1; m <= s_info.sent_used && count < max; m++) {
+		const stream_range_s *range = &s_info.sent[(s_info.sent_next + STREAM_REDUNDANCY_MAX - m) % STREAM_REDUNDANCY_MAX];
+
+		for (i = range->count; i > 0 && count < max; i--) {
+			unsigned int seq = range->first + i - 1;
+
+			if ((int)(first - seq) <= 0 || s_info.write_seq - seq > STREAM_RING_SIZE)
+				continue;
+			if (count && (int)(picked[count - 1] - seq) <= 0)
+				continue;
+			picked[count++] = seq;
+		}
+	}
+
+	for (i = 0; i < count; i++)
+		seqs[i] = picked[count - 1 - i];
+
+	return count;
+}
+
+static int _build_binary(unsigned int keys, int key_count, unsigned int first, unsigned int count, unsigned char *buf, int buf_size)
+{
+	unsigned int sensors = s_info.config.sensors;
+	bool timestamps = (s_info.caps & PROTO_CAP_TIMESTAMPS) != 0;
+	bool wheel = (s_info.caps & PROTO_CAP_WHEEL) && (s_info.wheel_pos != s_info.wheel_sent_pos || s_info.wheel_repeats);
+	bool pointer = (s_info.caps & PROTO_CAP_POINTER) && s_info.config.mode == STREAM_MODE_POINTER
+			&& (s_info.pointer_dirty || s_info.pointer_repeats);
+	bool wiimote = (s_info.caps & PROTO_CAP_WIIMOTE) != 0;
+	bool redundant = (s_info.caps & PROTO_CAP_REDUNDANCY) && s_info.redundancy;
+	unsigned int repeats = 0;
+	unsigned int repeat_seqs[STREAM_REDUNDANCY_MAX];
+	unsigned char flags = 0;
+	int accel_size = wiimote ? PROTO_SAMPLE_WIIMOTE_SIZE : PROTO_SAMPLE_AXES_SIZE;
+	int sample_size = accel_size;
+	unsigned char *body = buf + PROTO_HEADER_SIZE;
+	unsigned char *p = NULL;
+	unsigned char key_mask = keys & ((1u << (key_count < 8 ? key_count : 8)) - 1);
+	int body_len = 0;
+	unsigned int i;
+
+	if (timestamps)
+		sample_size += PROTO_SAMPLE_TS_SIZE;
+	if (sensors & STREAM_SENSOR_GYRO)
+		sample_size += PROTO_SAMPLE_AXES_SIZE;
+
+	body_len = PROTO_SAMPLES_HEADER_SIZE + sample_size * count;
+	if (wheel)
+		body_len += PROTO_WHEEL_SIZE;
+	if (pointer)
+		body_len += PROTO_POINTER_SIZE;
+	if (redundant) {
+		repeats = _pick_repeats(first, s_info.redundancy, repeat_seqs);
+		body_len += PROTO_REDUNDANT_SIZE + (PROTO_REPEAT_SEQ_SIZE + accel_size) * repeats;
+	}
+	if (PROTO_HEADER_SIZE + body_len > buf_size) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_SAMPLES, body_len);
+	body[0] = count;
+	body[1] = sensors;
+	body[2] = key_mask;
+	if (timestamps)
+		flags |= PROTO_SAMPLES_FLAG_TIMESTAMP;
+	if (wheel)
+		flags |= PROTO_SAMPLES_FLAG_WHEEL;
+	if (pointer)
+		flags |= PROTO_SAMPLES_FLAG_POINTER;
+	if (wiimote)
+		flags |= PROTO_SAMPLES_FLAG_WIIMOTE;
+	if (redundant)
+		flags |= PROTO_SAMPLES_FLAG_REDUNDANT;
+	body[3] = flags;
+
+	p = body + PROTO_SAMPLES_HEADER_SIZE;
+	if (wheel) {
+		proto_put_u16(p, s_info.wheel_pos & 0xffff);
+		proto_put_u16(p + 2, (s_info.wheel_pos - s_info.wheel_sent_pos) & 0xffff);
+		proto_put_u32(p + 4, s_info.wheel_timestamp);
+		p += PROTO_WHEEL_SIZE;
+		/* The position is absolute, repeating it heals a lost message */
+		if (s_info.wheel_pos != s_info.wheel_sent_pos)
+			s_info.wheel_repeats = STREAM_BLOCK_REPEAT;
+		else
+			s_info.wheel_repeats--;
+		s_info.wheel_sent_pos = s_info.wheel_pos;
+	}
+	if (pointer) {
+		proto_put_u16(p, (unsigned int)(s_info.pointer_x * 65535.0f));
+		proto_put_u16(p + 2, (unsigned int)(s_info.pointer_y * 65535.0f));
+		p[4] = s_info.pointer_touching;
+		p[5] = 0;
+		p += PROTO_POINTER_SIZE;
+		/*
+		 * Keep repeating while touched so a lost packet heals on the next,
+		 * and a few times after the lift so a lost lift cannot hold it down
+		 */
+		if (s_info.pointer_dirty)
+			s_info.pointer_repeats = STREAM_BLOCK_REPEAT;
+		else
+			s_info.pointer_repeats--;
+		s_info.pointer_dirty = s_info.pointer_touching;
+	}
+	if (redundant) {
+		proto_put_u16(p, first & 0xffff);
+		p[2] = repeats;
+		p[3] = 0;
+		p += PROTO_REDUNDANT_SIZE;
+		for (i = 0; i < repeats; i++) {
+			proto_put_u16(p, repeat_seqs[i] & 0xffff);
+			p += PROTO_REPEAT_SEQ_SIZE;
+			p += _put_accel(p, s_info.ring[repeat_seqs[i] % STREAM_RING_SIZE].accel, wiimote);
+		}
+	}
+	for (i = 0; i < count; i++) {
+		const stream_sample_s *sample = &s_info.ring[(first + i) % STREAM_RING_SIZE];
+
+		if (timestamps) {
+			proto_put_u32(p, (unsigned int)(sample->timestamp / 1000));
+			p += PROTO_SAMPLE_TS_SIZE;
+		}
+		p += _put_accel(p, sample->accel, wiimote);
+		if (sensors & STREAM_SENSOR_GYRO) {
+			_put_axes(p, sample->gyro, PROTO_GYRO_SCALE);
+			p += PROTO_SAMPLE_AXES_SIZE;
+		}
+	}
+	/* Before the first reading the zeroed slot is no sample to repeat */
+	if (s_info.write_seq)
+		_record_sent(first, count);
+
+	return PROTO_HEADER_SIZE + body_len;
+}
+
+static bool _within(const int *values, const int *ref)
+{
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		int diff = values[i] - ref[i];
+
+		if (diff > (int)s_info.deadband || diff < -(int)s_info.deadband)
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * Dead-band values in the units the phone sees, the band is set in those
+ */
+static void _accel_units(const float *accel, int *out)
+{
+	unsigned int packed = 0;
+	int i;
+
+	if (s_info.caps & PROTO_CAP_WIIMOTE) {
+		packed = calib_to_wiimote(accel);
+		for (i = 0; i < 3; i++)
+			out[i] = (packed >> (i * 10)) & 0x3ff;
+		return;
+	}
+
+	for (i = 0; i < 3; i++)
+		out[i] = (int)(accel[i] * PROTO_ACCEL_SCALE);
+}
+
+static void _gyro_units(const float *gyro, int *out)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+		out[i] = (int)(gyro[i] * PROTO_GYRO_SCALE);
+}
+
+static bool _sample_within(const stream_sample_s *sample)
+{
+	int values[3];
+
+	_accel_units(sample->accel, values);
+	if (!_within(values, s_info.idle_accel))
+		return false;
+
+	if (s_info.config.sensors & STREAM_SENSOR_GYRO) {
+		_gyro_units(sample->gyro, values);
+		if (!_within(values, s_info.idle_gyro))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+ * True when the samples can be replaced by a heartbeat: nothing moved
+ * past the dead-band since the last full message and no key, wheel or
+ * pointer change is waiting
+ */
+static bool _is_idle(unsigned int key_mask, unsigned int first, unsigned int count)
+{
+	unsigned int i;
+
+	if (!s_info.deadband || !(s_info.caps & PROTO_CAP_DEADBAND) || !s_info.idle_ref_valid) {
+		return false;
+	}
+
+	if (key_mask != s_info.idle_keys || s_info.idle_heartbeats >= s_info.idle_refresh) {
+		return false;
+	}
+
+	if (s_info.wheel_pos != s_info.wheel_sent_pos || s_info.wheel_repeats
+			|| ((s_info.pointer_dirty || s_info.pointer_repeats) && s_info.config.mode == STREAM_MODE_POINTER)) {
+		return false;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!_sample_within(&s_info.ring[(first + i) % STREAM_RING_SIZE]))
+			return false;
+	}
+
+	return true;
+}
+
+static void _set_idle_reference(unsigned int key_mask, const stream_sample_s *sample)
+{
+	_accel_units(sample->accel, s_info.idle_accel);
+	_gyro_units(sample->gyro, s_info.idle_gyro);
+	s_info.idle_keys = key_mask;
+	s_info.idle_heartbeats = 0;
+	s_info.idle_ref_valid = true;
+	s_info.idle_wake = false;
+}
+
+/*
+ * True for the first sample past the dead-band once heartbeats went out,
+ * the motion must not wait for the next poll
+ */
+static bool _leaves_deadband(const stream_sample_s *sample)
+{
+	if (!s_info.deadband || !(s_info.caps & PROTO_CAP_DEADBAND) || !s_info.idle_ref_valid) {
+		return false;
+	}
+
+	if (!s_info.idle_heartbeats || s_info.idle_wake || _sample_within(sample)) {
+		return false;
+	}
+
+	s_info.idle_wake = true;
+	return true;
+}
+
+static int _build_heartbeat(unsigned int key_mask, unsigned int count, unsigned char *buf, int buf_size)
+{
+	unsigned char *body = buf + PROTO_HEADER_SIZE;
+
+	if (buf_size < PROTO_HEADER_SIZE + PROTO_HEARTBEAT_SIZE) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_HEARTBEAT, PROTO_HEARTBEAT_SIZE);
+	body[0] = key_mask;
+	body[1] = count < 255 ? count : 255;
+	s_info.idle_heartbeats++;
+
+	return PROTO_HEADER_SIZE + PROTO_HEARTBEAT_SIZE;
+}
+
+/*
+ * @brief: Encode the pending samples with the active encoding
+ * @param[keys]: Key bitmask, bit n set while key n is down
+ * @param[key_count]: Number of keys
+ * @param[buf]: Output buffer
+ * @param[buf_size]: Size of the output buffer
+ * Returns the message length, 0 if the buffer is too small
+ */
+int stream_build_message(unsigned int keys, int key_count, unsigned char *buf, int buf_size)
+{
+	unsigned int first = 0;
+	unsigned int count = _take_samples(&first);
+	unsigned int key_mask = keys & ((1u << (key_count < 8 ? key_count : 8)) - 1);
+	int len = 0;
+
+	if (s_info.config.encoding == STREAM_ENCODING_BINARY) {
+		if (_is_idle(key_mask, first, count)) {
+			return _build_heartbeat(key_mask, count, buf, buf_size);
+		}
+
+		len = _build_binary(keys, key_count, first, count, buf, buf_size);
+		if (len > 0)
+			_set_idle_reference(key_mask, &s_info.ring[(first + count - 1) % STREAM_RING_SIZE]);
+		return len;
+	}
+
+	return _build_text(keys, key_count, first, count, buf, buf_size);
+}
+
+/*
+ * @brief: Encode a key change as a PROTO_MSG_KEYS message
+ * @param[keys]: Key bitmask, bit n set while key n is down
+ * @param[key_count]: Number of keys
+ * @param[buf]: Output buffer
+ * @param[buf_size]: Size of the output buffer
+ * Returns the message length, 0 if the phone did not ask for key events
+ */
+int stream_build_keys(unsigned int keys, int key_count, unsigned char *buf, int buf_size)
+{
+	/* A text stream phone would read the binary message as a poll reply */
+	if (s_info.config.encoding != STREAM_ENCODING_BINARY || !(s_info.caps & PROTO_CAP_KEY_EVENTS)) {
+		return 0;
+	}
+
+	if (buf_size < PROTO_HEADER_SIZE + PROTO_KEYS_SIZE) {
+		return 0;
+	}
+
+	proto_put_header(buf, PROTO_MSG_KEYS, PROTO_KEYS_SIZE);
+	buf[PROTO_HEADER_SIZE] = keys & ((1u << (key_count < 8 ? key_count : 8)) - 1);
+
+	return PROTO_HEADER_SIZE + PROTO_KEYS_SIZE;
+}
+
+/*
+ * @brief: Bytes held by the stream component, the sample ring included
+ */
+size_t stream_memory(void)
+{
+	return sizeof(s_info);
+}
@@ -0,0 +1,354 @@
+/*
+ * Copyright (c) 2015 Samsung Electronics Co., Ltd
+ *
+ * Licensed under the Flora License, Version 1.1 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://floralicense.org/license/
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <app_common.h>
+#include "hellomex.h"
+#include "logger.h"
+#include "thumb.h"
+
+/*
+ * Each thumbnail is held by a hidden image object with a load size, so
+ * the decoder scales while decoding and the surface stays in the evas
+ * image cache for as long as the holder lives. Loading goes through
+ * evas preloading, which decodes on an evas worker thread. Setting the
+ * same file and prescale on a visible elm_image is then a cache hit.
+ * Downscaled copies are written to the cache directory from an idler and
+ * used instead of the original on later launches.
+ */
+typedef struct _thumb_entry {
+	Evas_Object *holder;
+	Evas_Object *target;
+	char *source;
+	char *file;		/* what the holder decodes, the saved copy or the source */
+	char *saved;		/* where the downscaled copy lives */
+	unsigned int bytes;
+	unsigned int last_used;
+	bool ready;
+	bool save_pending;
+} thumb_entry_s;
+
+static struct _s_info {
+	thumb_entry_s entries[THUMB_CACHE_MAX];
+	unsigned int bytes;
+	unsigned int clock;
+	char *cache_path;
+	Ecore_Idler *save_idler;
+} s_info = {
+	.bytes = 0,
+	.clock = 0,
+	.cache_path = NULL,
+	.save_idler = NULL,
+};
+
+static void _target_del_cb(void *data, Evas *e, Evas_Object *obj, void *event_info)
+{
+	thumb_entry_s *entry = data;
+
+	if (entry->target == obj)
+		entry->target = NULL;
+}
+
+static void _set_target(thumb_entry_s *entry, Evas_Object *img)
+{
+	if (entry->target == img) {
+		return;
+	}
+
+	if (entry->target)
+		evas_object_event_callback_del_full(entry->target, EVAS_CALLBACK_DEL, _target_del_cb, entry);
+	entry->target = img;
+	if (img)
+		evas_object_event_callback_add(img, EVAS_CALLBACK_DEL, _target_del_cb, entry);
+}
+
+static void _apply(thumb_entry_s *entry, Evas_Object *img)
+{
+	elm_image_prescale_set(img, THUMB_SIZE);
+	elm_image_file_set(img, entry->file, NULL);
+}
+
+static void _release(thumb_entry_s *entry)
+{
+	_set_target(entry, NULL);
+
+	if (entry->holder)
+		evas_object_del(entry->holder);
+
+	free(entry->source);
+	free(entry->file);
+	free(entry->saved);
+	s_info.bytes -= entry->bytes;
+	memset(entry, 0, sizeof(*entry));
+}
+
+/*
+ * Evicts the least recently used decoded thumbnails until the budget
+ * holds, never the one just loaded
+ */
+static void _evict(const thumb_entry_s *keep)
+{
+	while (s_info.bytes > THUMB_CACHE_BUDGET) {
+		thumb_entry_s *oldest = NULL;
+		int i;
+
+		for (i = 0; i < THUMB_CACHE_MAX; i++) {
+			thumb_entry_s *entry = &s_info.entries[i];
+
+			if (entry->ready && entry != keep && (oldest == NULL || entry->last_used < oldest->last_used))
+				oldest = entry;
+		}
+
+		if (oldest == NULL) {
+			break;
+		}
+
+		LOGGER_D(LOG_TAG, "thumbnail of %s evicted", oldest->source);
+		_release(oldest);
+	}
+}
+
+static Eina_Bool _save_idler_cb(void *data)
+{
+	int i;
+
+	/* One encode per idle pass keeps each pass short */
+	for (i = 0; i < THUMB_CACHE_MAX; i++) {
+		thumb_entry_s *entry = &s_info.entries[i];
+
+		if (!entry->save_pending) {
+			continue;
+		}
+
+		entry->save_pending = false;
+		if (!evas_object_image_save(entry->holder, entry->saved, NULL, "quality=90")) {
+			dlog_print(DLOG_ERROR, LOG_TAG, "failed to save the thumbnail %s", entry->saved);
+		}
+
+		return ECORE_CALLBACK_RENEW;
+	}
+
+	s_info.save_idler = NULL;
+
+	return ECORE_CALLBACK_CANCEL;
+}
+
+static void _preloaded_cb(void *data, Evas *e, Evas_Object *obj, void *event_info)
+{
+	thumb_entry_s *entry = data;
+	int w = 0;
+	int h = 0;
+
+	if (evas_object_image_load_error_get(obj) != EVAS_LOAD_ERROR_NONE) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to decode %s", entry->file);
+		_release(entry);
+		return;
+	}
+
+	evas_object_image_size_get(obj, &w, &h);
+	entry->bytes = w * h * 4;
+	entry->ready = true;
+	s_info.bytes += entry->bytes;
+
+	if (entry->target) {
+		_apply(entry, entry->target);
+		_set_target(entry, NULL);
+	}
+
+	if (entry->saved && strcmp(entry->file, entry->saved)) {
+		entry->save_pending = true;
+		if (s_info.save_idler == NULL)
+			s_info.save_idler = ecore_idler_add(_save_idler_cb, NULL);
+	}
+
+	_evict(entry);
+}
+
+/*
+ * Returns the path of the downscaled copy of a source, keyed by its path
+ * and modification time so a replaced file gets a new thumbnail
+ */
+static char *_saved_path(const char *source)
+{
+	unsigned int hash = 2166136261u;
+	struct stat st;
+	char path[PATH_MAX] = { 0, };
+	const char *p = NULL;
+
+	if (s_info.cache_path == NULL) {
+		s_info.cache_path = app_get_cache_path();
+		if (s_info.cache_path == NULL) {
+			return NULL;
+		}
+	}
+
+	if (stat(source, &st) != 0) {
+		return NULL;
+	}
+
+	for (p = source; *p; p++) {
+		hash ^= (unsigned char)*p;
+		hash *= 16777619u;
+	}
+
+	snprintf(path, sizeof(path), "%sthumb_%08x_%lx.jpg", s_info.cache_path, hash, (unsigned long)st.st_mtime);
+
+	return strdup(path);
+}
+
+static thumb_entry_s *_find(const char *source)
+{
+	int i;
+
+	for (i = 0; i < THUMB_CACHE_MAX; i++) {
+		if (s_info.entries[i].source && !strcmp(s_info.entries[i].source, source))
+			return &s_info.entries[i];
+	}
+
+	return NULL;
+}
+
+static thumb_entry_s *_new_entry(void)
+{
+	thumb_entry_s *oldest = NULL;
+	int i;
+
+	for (i = 0; i < THUMB_CACHE_MAX; i++) {
+		thumb_entry_s *entry = &s_info.entries[i];
+
+		if (entry->source == NULL)
+			return entry;
+		if (oldest == NULL || entry->last_used < oldest->last_used)
+			oldest = entry;
+	}
+
+	_release(oldest);
+
+	return oldest;
+}
+
+static bool _load(thumb_entry_s *entry, Evas *evas, const char *source)
+{
+	struct stat st;
+
+	entry->source = strdup(source);
+	entry->saved = _saved_path(source);
+	if (entry->saved && stat(entry->saved, &st) == 0) {
+		entry->file = strdup(entry->saved);
+	} else {
+		entry->file = strdup(source);
+	}
+
+	entry->holder = evas_object_image_filled_add(evas);
+	if (entry->source == NULL || entry->file == NULL || entry->holder == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to create the thumbnail of %s", source);
+		return false;
+	}
+
+	evas_object_image_load_size_set(entry->holder, THUMB_SIZE, THUMB_SIZE);
+	evas_object_image_file_set(entry->holder, entry->file, NULL);
+	evas_object_event_callback_add(entry->holder, EVAS_CALLBACK_IMAGE_PRELOADED, _preloaded_cb, entry);
+	evas_object_image_preload(entry->holder, EINA_FALSE);
+
+	return true;
+}
+
+/*
+ * @brief: Show an image file in an elm_image through the thumbnail cache
+ * @param[img]: elm_image to set
+ * @param[image_path]: Full size image file
+ * The image keeps what it showed until the thumbnail is decoded.
+ */
+void thumb_set(Evas_Object *img, const char *image_path)
+{
+	thumb_entry_s *entry = NULL;
+	int i;
+
+	if (img == NULL || image_path == NULL) {
+		return;
+	}
+
+	/* A newer request for the same image replaces any older one */
+	for (i = 0; i < THUMB_CACHE_MAX; i++) {
+		if (s_info.entries[i].target == img)
+			_set_target(&s_info.entries[i], NULL);
+	}
+
+	entry = _find(image_path);
+	if (entry == NULL) {
+		entry = _new_entry();
+		if (!_load(entry, evas_object_evas_get(img), image_path)) {
+			_release(entry);
+			return;
+		}
+	}
+
+	entry->last_used = ++s_info.clock;
+	if (entry->ready) {
+		_apply(entry, img);
+	} else {
+		_set_target(entry, img);
+	}
+}
+
+/*
+ * @brief: Drop the decoded thumbnails, keeping the ones still loading for a target
+ * Saved copies stay on disk, so a dropped thumbnail comes back without the full decode.
+ */
+size_t thumb_trim(void)
+{
+	size_t before = s_info.bytes;
+	int i;
+
+	for (i = 0; i < THUMB_CACHE_MAX; i++) {
+		thumb_entry_s *entry = &s_info.entries[i];
+
+		if (entry->source && entry->target == NULL && !entry->save_pending)
+			_release(entry);
+	}
+
+	return before - s_info.bytes;
+}
+
+/*
+ * @brief: Bytes held by decoded thumbnails
+ */
+size_t thumb_memory(void)
+{
+	return s_info.bytes;
+}
+
+/*
+ * @brief: Drop every decoded thumbnail and pending request
+ */
+void thumb_finalize(void)
+{
+	int i;
+
+	if (s_info.save_idler) {
+		ecore_idler_del(s_info.save_idler);
+		s_info.save_idler = NULL;
+	}
+
+	for (i = 0; i < THUMB_CACHE_MAX; i++) {
+		_release(&s_info.entries[i]);
+	}
+
+	free(s_info.cache_path);
+	s_info.cache_path = NULL;
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2016 Samsung Electronics Co., Ltd. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "hellomex.h"
+#include "logger.h"
+#include "toast.h"
+
+/*
+ * One popup is made on first use and only hidden when dismissed, so a
+ * toast is a text change and a show. The same text again within
+ * TOAST_REPEAT_WINDOW of the last show is dropped, on screen or not, and
+ * never extends the timeout; a different text arriving too soon is kept
+ * in a single pending slot, newest wins, and shown from a timer.
+ */
+static struct _s_info {
+	Evas_Object *parent;
+	Evas_Object *popup;
+	Ecore_Timer *pending_timer;
+	bool visible;
+	double shown;
+	unsigned int coalesced;
+	char text[TOAST_TEXT_SIZE];
+	char pending[TOAST_TEXT_SIZE];
+} s_info = {
+	.parent = NULL,
+	.popup = NULL,
+	.pending_timer = NULL,
+	.visible = false,
+	.shown = 0.0,
+	.coalesced = 0,
+};
+
+static void _dismiss_cb(void *data, Evas_Object *obj, void *event_info)
+{
+	elm_popup_dismiss(obj);
+}
+
+static void _dismissed_cb(void *data, Evas_Object *obj, void *event_info)
+{
+	evas_object_hide(obj);
+	s_info.visible = false;
+}
+
+static void _back_cb(void *data, Evas_Object *obj, void *event_info)
+{
+	elm_popup_dismiss(obj);
+}
+
+static Evas_Object *_get_popup(void)
+{
+	Evas_Object *popup = NULL;
+
+	if (s_info.popup) {
+		return s_info.popup;
+	}
+
+	if (s_info.parent == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "toast parent is NULL.");
+		return NULL;
+	}
+
+	popup = elm_popup_add(s_info.parent);
+	if (popup == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to create the toast popup.");
+		return NULL;
+	}
+
+	elm_object_style_set(popup, "toast/circle");
+	elm_popup_orient_set(popup, ELM_POPUP_ORIENT_BOTTOM);
+	evas_object_size_hint_weight_set(popup, EVAS_HINT_EXPAND, EVAS_HINT_EXPAND);
+	eext_object_event_callback_add(popup, EEXT_CALLBACK_BACK, _back_cb, NULL);
+	evas_object_smart_callback_add(popup, "dismissed", _dismissed_cb, NULL);
+	evas_object_smart_callback_add(popup, "block,clicked", _dismiss_cb, NULL);
+	evas_object_smart_callback_add(popup, "timeout", _dismiss_cb, NULL);
+
+	s_info.popup = popup;
+
+	return popup;
+}
+
+static void _show(const char *text)
+{
+	Evas_Object *popup = _get_popup();
+
+	if (popup == NULL) {
+		return;
+	}
+
+	if (strcmp(s_info.text, text)) {
+		snprintf(s_info.text, sizeof(s_info.text), "%s", text);
+		elm_object_part_text_set(popup, "elm.text", s_info.text);
+	}
+
+	/* Setting the timeout again restarts it */
+	elm_popup_timeout_set(popup, TOAST_TIMEOUT);
+	evas_object_show(popup);
+
+	s_info.visible = true;
+	s_info.shown = ecore_time_get();
+}
+
+static Eina_Bool _pending_timer_cb(void *data)
+{
+	s_info.pending_timer = NULL;
+	_show(s_info.pending);
+	s_info.pending[0] = '\0';
+
+	return ECORE_CALLBACK_CANCEL;
+}
+
+/*
+ * @brief: Set the parent of the shared popup
+ * @param[parent]: Object the popup is added to
+ */
+void toast_initialize(Evas_Object *parent)
+{
+	s_info.parent = parent;
+
+	/* A toast asked for before the window existed */
+	if (s_info.pending[0] && s_info.pending_timer == NULL) {
+		_show(s_info.pending);
+		s_info.pending[0] = '\0';
+	}
+}
+
+/*
+ * @brief: Delete the popup and drop a pending toast
+ */
+void toast_finalize(void)
+{
+	if (s_info.pending_timer) {
+		ecore_timer_del(s_info.pending_timer);
+		s_info.pending_timer = NULL;
+	}
+
+	if (s_info.popup) {
+		evas_object_del(s_info.popup);
+		s_info.popup = NULL;
+	}
+
+	s_info.parent = NULL;
+	s_info.visible = false;
+	s_info.text[0] = '\0';
+	s_info.pending[0] = '\0';
+}
+
+/*
+ * @brief: Show a short notification, never waits
+ * @param[text]: Text, copied and truncated to TOAST_TEXT_SIZE
+ */
+void toast_show(const char *text)
+{
+	double now = 0.0;
+	double wait = 0.0;
+
+	if (text == NULL) {
+		return;
+	}
+
+	if (s_info.parent == NULL) {
+		snprintf(s_info.pending, sizeof(s_info.pending), "%s", text);
+		return;
+	}
+
+	now = ecore_time_get();
+	if ((!strncmp(s_info.text, text, sizeof(s_info.text) - 1) && now - s_info.shown < TOAST_REPEAT_WINDOW)
+			|| (s_info.pending_timer && !strncmp(s_info.pending, text, sizeof(s_info.pending) - 1))) {
+		s_info.coalesced++;
+		LOGGER_D(LOG_TAG, "toast repeated (%u)", s_info.coalesced);
+		return;
+	}
+
+	wait = s_info.shown + TOAST_MIN_INTERVAL - now;
+	if (!s_info.visible || wait <= 0.0) {
+		/* An older pending text must not replace this one when its timer fires */
+		if (s_info.pending_timer) {
+			ecore_timer_del(s_info.pending_timer);
+			s_info.pending_timer = NULL;
+		}
+		s_info.pending[0] = '\0';
+		_show(text);
+		return;
+	}
+
+	snprintf(s_info.pending, sizeof(s_info.pending), "%s", text);
+	if (s_info.pending_timer == NULL) {
+		s_info.pending_timer = ecore_timer_add(wait, _pending_timer_cb, NULL);
+	}
+}
@@ -21,6 +21,7 @@
 #include <dlog.h>
 #include "view.h"
 #include "hellomex.h"
+#include "thumb.h"
 
 #define LABEL_STYLE_START "<font=Tizen:style=Regular><font_size=36><align=center><color=#FAFAFA><wrap=mixed>"
 #define LABEL_STYLE_END "</wrap></color></align></font_size></font>"
@@ -506,6 +507,73 @@ void view_set_button(Evas_Object *parent, const char *part_name, const char *sty
 	evas_object_show(btn);
 }
 
+/*
+ * @brief: Make and set a controller button from the art compiled into the EDJ
+ * @param[parent]: Object to which you want to set the button
+ * @param[part_name]: Name of part to which you want to set the button, also picks the icon
+ * @param[file_path]: File path of EDJ that has the controller button group
+ * No image file is opened, the icon is a state of the shared group.
+ */
+void view_set_controller_button(Evas_Object *parent, const char *part_name, const char *file_path)
+{
+	Evas_Object *btn = NULL;
+	char signal[64] = { 0, };
+
+	if (parent == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "parent is NULL.");
+		return;
+	}
+
+	btn = view_create_layout(parent, file_path, GRP_CONTROLLER_BUTTON, NULL, NULL);
+	if (btn == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to create controller button.");
+		return;
+	}
+
+	snprintf(signal, sizeof(signal), "icon,%s", part_name);
+	elm_object_signal_emit(btn, signal, "");
+	/* Apply the icon state now so the first frame does not show the default one */
+	edje_object_message_signal_process(elm_layout_edje_get(btn));
+
+	elm_object_part_content_set(parent, part_name, btn);
+}
+
+/*
+ * @brief: Track raw touches on a button, including extra fingers
+ * @param[parent]: Object that has the button part
+ * @param[part_name]: Name of part the button is set to
+ * @param[down_cb]: Function will be operated when any finger goes down on the button
+ * @param[up_cb]: Function will be operated when that finger is lifted
+ * @param[user_data]: Data passed to the callbacks
+ * Unlike "clicked" this fires on the press edge and for every finger, so
+ * several buttons can be held at once. event_info differs between the
+ * first finger (mouse) and extra fingers (multi), callbacks must not use it.
+ */
+void view_set_button_touch_callback(Evas_Object *parent, const char *part_name, Evas_Object_Event_Cb down_cb, Evas_Object_Event_Cb up_cb, void *user_data)
+{
+	Evas_Object *btn = NULL;
+
+	if (parent == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "parent is NULL.");
+		return;
+	}
+
+	btn = elm_object_part_content_get(parent, part_name);
+	if (btn == NULL) {
+		dlog_print(DLOG_ERROR, LOG_TAG, "failed to get button.");
+		return;
+	}
+
+	if (down_cb) {
+		evas_object_event_callback_add(btn, EVAS_CALLBACK_MOUSE_DOWN, down_cb, user_data);
+		evas_object_event_callback_add(btn, EVAS_CALLBACK_MULTI_DOWN, down_cb, user_data);
+	}
+	if (up_cb) {
+		evas_object_event_callback_add(btn, EVAS_CALLBACK_MOUSE_UP, up_cb, user_data);
+		evas_object_event_callback_add(btn, EVAS_CALLBACK_MULTI_UP, up_cb, user_data);
+	}
+}
+
 /*
  * @brief: Set a more button
  * @param[parent]: Object has part to which you want to set
@@ -700,6 +768,7 @@ void view_music_set_title_layout(Evas_Object *parent, const char *part_name, con
  * @param[part_name]: Part name to which you want to set
  * @param[image_path]: Path of album art file you want to set
  * @param[default_image_path]: Path of default album art file
+ * The art shows up once its thumbnail is decoded.
  */
 void view_music_set_album_art(Evas_Object *parent, const char *part_name, const char *image_path, const char *default_image_path)
 {
@@ -714,7 +783,8 @@ void view_music_set_album_art(Evas_Object *parent, const char *part_name, const
 			elm_object_part_content_set(parent, part_name, img);
 		}
 
-		elm_image_file_set(img, image_path, NULL);
+		/* Covers are decoded off the main loop at screen size */
+		thumb_set(img, image_path);
 	}
 }
 